@@ -0,0 +1,86 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include "ioExecutor.hpp"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pfr
+{
+
+// BMC flash controller, all BMC mtd devices sit behind it.
+static constexpr const char* spiFlashQueue = "spi-flash";
+
+/** @brief Queue name of an I2C bus, same as its device node */
+inline std::string i2cBusQueue(const uint64_t bus)
+{
+    return "i2c-" + std::to_string(bus);
+}
+
+/** @class BusQueues
+ *  @brief One transaction queue per physical bus, each with its own
+ *         worker thread. Transactions on one bus are serialized, those on
+ *         different buses proceed in parallel. Used from the D-Bus thread
+ *         only.
+ */
+class BusQueues
+{
+  public:
+    explicit BusQueues(boost::asio::io_context& io) : dbusIo(io) {}
+
+    BusQueues(const BusQueues&) = delete;
+    BusQueues& operator=(const BusQueues&) = delete;
+
+    /** @brief Queue of the bus, started on first use
+     *
+     *  @param[in] bus          - Queue name of the bus
+     */
+    IoExecutor& queue(const std::string& bus)
+    {
+        IoExecutor*& executor = queues[bus];
+        if (executor == nullptr)
+        {
+            owned.emplace_back(std::make_unique<IoExecutor>(dbusIo));
+            executor = owned.back().get();
+        }
+        return *executor;
+    }
+
+    /** @brief Serves the bus from an existing queue, unless the bus has
+     *         one already. For devices whose queue was picked before their
+     *         bus was known.
+     *
+     *  @param[in] bus          - Queue name of the bus
+     *  @param[in] executor     - Queue already used by the device
+     */
+    void attach(const std::string& bus, IoExecutor& executor)
+    {
+        queues.try_emplace(bus, &executor);
+    }
+
+  private:
+    boost::asio::io_context& dbusIo;
+    std::vector<std::unique_ptr<IoExecutor>> owned;
+    std::map<std::string, IoExecutor*> queues;
+};
+
+} // namespace pfr
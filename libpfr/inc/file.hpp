@@ -111,28 +111,36 @@ class I2CFile
         return true;
     }
 
-    /** @brief Writes the byte data to I2C dev
+    /** @brief Writes the byte data to I2C dev. Retries are left to the
+     *         caller so that no thread sleeps here.
      *
      *  @param[in] Offset       -  Offset value
      *  @param[in] Byte data    -  Data
      */
     void i2cWriteByteData(const uint8_t offset, const uint8_t value)
     {
-        int retries = 3;
-        while (i2c_smbus_write_byte_data(fd, offset, value) < 0)
+        if (i2c_smbus_write_byte_data(fd, offset, value) < 0)
         {
-            phosphor::logging::log<phosphor::logging::level::WARNING>(
-                "PFR: I2c write failed, retrying....",
-                phosphor::logging::entry("COUNT=%d", retries));
-            if (!retries--)
-            {
-                throw std::runtime_error("i2c_smbus_write_byte_data() failed");
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            throw std::runtime_error("i2c_smbus_write_byte_data() failed");
         }
         return;
     }
 
+    /** @brief Writes a block of data to I2C dev, at most 32 bytes
+     *
+     *  @param[in] offset       -  Offset value
+     *  @param[in] length       -  length value
+     *  @param[in] value        -  data pointer
+     */
+    void i2cWriteBlockData(const uint8_t offset, const uint8_t length,
+                           const uint8_t* value)
+    {
+        if (i2c_smbus_write_i2c_block_data(fd, offset, length, value) < 0)
+        {
+            throw std::runtime_error("i2c_smbus_write_i2c_block_data() failed");
+        }
+    }
+
     ~I2CFile()
     {
         if (!(fd < 0))
@@ -0,0 +1,165 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace pfr
+{
+
+/** Two lower case hex digits of every byte value */
+inline constexpr std::array<std::array<char, 2>, 256> hexDigits = []() {
+    constexpr std::string_view digits = "0123456789abcdef";
+    std::array<std::array<char, 2>, 256> table = {};
+    for (size_t i = 0; i < table.size(); i++)
+    {
+        table[i] = {digits[i >> 4], digits[i & 0x0F]};
+    }
+    return table;
+}();
+
+/** @class FixedString
+ *  @brief Null terminated string in a buffer of fixed capacity, for
+ *         formatting without heap allocations. Anything appended past the
+ *         capacity is dropped.
+ */
+template <size_t Capacity>
+class FixedString
+{
+  public:
+    constexpr FixedString& append(const char c)
+    {
+        if (length < Capacity)
+        {
+            buffer[length++] = c;
+            buffer[length] = '\0';
+        }
+        return *this;
+    }
+
+    constexpr FixedString& append(std::string_view str)
+    {
+        for (const char c : str)
+        {
+            append(c);
+        }
+        return *this;
+    }
+
+    /** @brief Appends the value as two lower case hex digits */
+    constexpr FixedString& appendHex(const uint8_t value)
+    {
+        append(hexDigits[value][0]);
+        return append(hexDigits[value][1]);
+    }
+
+    constexpr FixedString& appendHex(const uint8_t* data, const size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            appendHex(data[i]);
+        }
+        return *this;
+    }
+
+    constexpr FixedString& appendDecimal(uint32_t value)
+    {
+        std::array<char, 10> digits = {};
+        size_t count = 0;
+        do
+        {
+            digits[count++] = static_cast<char>('0' + (value % 10));
+            value /= 10;
+        } while (value != 0);
+        while (count != 0)
+        {
+            append(digits[--count]);
+        }
+        return *this;
+    }
+
+    constexpr std::string_view view() const
+    {
+        return std::string_view(buffer.data(), length);
+    }
+
+    constexpr const char* c_str() const
+    {
+        return buffer.data();
+    }
+
+    /** @brief Copy, allocation free up to the std::string small buffer */
+    std::string str() const
+    {
+        return std::string(view());
+    }
+
+    constexpr size_t size() const
+    {
+        return length;
+    }
+
+    static constexpr size_t capacity()
+    {
+        return Capacity;
+    }
+
+  private:
+    std::array<char, Capacity + 1> buffer = {};
+    size_t length = 0;
+};
+
+// <major>.<minor>
+using MajorMinorString = FixedString<7>;
+// <major>.<minor>-<build num>-g<build hash>, up to 19 characters
+using BMCVersionString = FixedString<MajorMinorString::capacity() + 12>;
+
+/** @brief Formats a version held as two binary bytes, e.g. 0.11 */
+constexpr MajorMinorString formatVersion(const uint8_t majorVer,
+                                         const uint8_t minorVer)
+{
+    MajorMinorString version;
+    version.appendDecimal(majorVer).append('.').appendDecimal(minorVer);
+    return version;
+}
+
+/** @brief Formats the BMC version of a PFM, e.g. 0.11-7-g1e5c2d
+ *
+ *  @param[in] majorVer     - Major version
+ *  @param[in] minorVer     - Minor version
+ *  @param[in] buildNo      - Build number
+ *  @param[in] buildHash    - Build hash, 3 bytes
+ */
+constexpr BMCVersionString formatBMCVersion(const uint8_t majorVer,
+                                            const uint8_t minorVer,
+                                            const uint8_t buildNo,
+                                            const uint8_t* buildHash)
+{
+    BMCVersionString version;
+    version.append(formatVersion(majorVer, minorVer).view())
+        .append('-')
+        .appendDecimal(buildNo)
+        .append("-g")
+        .appendHex(buildHash, 3);
+    return version;
+}
+
+} // namespace pfr
@@ -0,0 +1,359 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include "metrics.hpp"
+
+#include <boost/asio.hpp>
+#include <boost/asio/spawn.hpp>
+#include <phosphor-logging/log.hpp>
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace pfr
+{
+
+/** Transaction priority classes, most urgent first */
+enum class Priority
+{
+    // Writes the CPLD waits for, e.g. boot checkpoints and BMC busy.
+    critical,
+    // Event polling and reads serving D-Bus Gets.
+    polling,
+    // Version and status refresh sweeps.
+    background
+};
+
+/** @class IoExecutor
+ *  @brief Runs blocking hardware transactions on a dedicated thread and
+ *         completes them back on the D-Bus io_context. Queued transactions
+ *         run by priority class, so a critical write waits for at most the
+ *         transaction in progress. A class over its bus time budget yields
+ *         to the other classes, but never leaves the bus idle. A
+ *         transaction at its class deadline runs first, over budget or
+ *         not.
+ */
+class IoExecutor
+{
+  private:
+    using Clock = std::chrono::steady_clock;
+    using WorkGuard = boost::asio::executor_work_guard<
+        boost::asio::io_context::executor_type>;
+
+    struct ClassPolicy
+    {
+        // Longest queueing delay, zero for none.
+        std::chrono::milliseconds deadline;
+        // Bus time per budget window.
+        std::chrono::milliseconds budget;
+    };
+
+    static constexpr auto budgetWindow = std::chrono::seconds(1);
+    static constexpr std::array<ClassPolicy, priorityClasses> policies = {{
+        {std::chrono::milliseconds(100), std::chrono::milliseconds(1000)},
+        {std::chrono::milliseconds(1000), std::chrono::milliseconds(500)},
+        {std::chrono::milliseconds(0), std::chrono::milliseconds(250)},
+    }};
+    static_assert(static_cast<size_t>(Priority::background) + 1 ==
+                  priorityClasses);
+
+    struct Transaction
+    {
+        std::move_only_function<void()> run;
+        Clock::time_point queued;
+    };
+
+    /** @brief io_context running the D-Bus connection */
+    boost::asio::io_context& dbusIo;
+    /** @brief io_context owned by the hardware I/O thread */
+    boost::asio::io_context hwIo;
+    WorkGuard work;
+
+    /** @brief Guards the queues, filled from any thread */
+    std::mutex queueMutex;
+    std::array<std::deque<Transaction>, priorityClasses> queues;
+    /** @brief A runNext is posted, it picks the next transaction only
+     *         when it runs
+     */
+    bool dispatching = false;
+    /** @brief Bus time used in the current window, I/O thread only */
+    std::array<Clock::duration, priorityClasses> used = {};
+    Clock::time_point windowStart = Clock::now();
+
+    std::thread thread;
+
+    static constexpr auto retryDelay = std::chrono::milliseconds(10);
+
+    template <typename Handler, typename Result>
+    void complete(Handler&& handler, Result&& result)
+    {
+        boost::asio::post(dbusIo, [handler = std::forward<Handler>(handler),
+                                   result = std::forward<Result>(
+                                       result)]() mutable {
+            handler(std::move(result));
+        });
+    }
+
+    void schedule(const Priority priority, std::move_only_function<void()> run)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            queues[static_cast<size_t>(priority)].push_back(
+                {std::move(run), Clock::now()});
+            if (dispatching)
+            {
+                return;
+            }
+            dispatching = true;
+        }
+        boost::asio::post(hwIo, [this]() { runNext(); });
+    }
+
+    /** @brief Most urgent class with work, preferring one whose oldest
+     *         transaction reached its deadline, then those within their
+     *         budget. Called with the queue lock held.
+     *
+     *  @param[in] now          - Dispatch time
+     */
+    size_t pickClass(const Clock::time_point& now)
+    {
+        for (size_t i = 0; i < priorityClasses; i++)
+        {
+            const auto& deadline = policies[i].deadline;
+            if (!queues[i].empty() && (deadline.count() != 0) &&
+                ((now - queues[i].front().queued) >= deadline))
+            {
+                return i;
+            }
+        }
+
+        size_t fallback = priorityClasses;
+        for (size_t i = 0; i < priorityClasses; i++)
+        {
+            if (queues[i].empty())
+            {
+                continue;
+            }
+            if (used[i] < policies[i].budget)
+            {
+                return i;
+            }
+            if (fallback == priorityClasses)
+            {
+                fallback = i;
+            }
+        }
+        return fallback;
+    }
+
+    /** @brief Runs the most urgent queued transaction on the I/O thread,
+     *         then posts itself again while work is queued
+     */
+    void runNext()
+    {
+        auto start = Clock::now();
+        if ((start - windowStart) >= budgetWindow)
+        {
+            windowStart = start;
+            used.fill(Clock::duration::zero());
+        }
+
+        Transaction next;
+        size_t cls = 0;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            cls = pickClass(start);
+            if (cls == priorityClasses)
+            {
+                dispatching = false;
+                return;
+            }
+            next = std::move(queues[cls].front());
+            queues[cls].pop_front();
+        }
+
+        next.run();
+
+        auto busy = Clock::now() - start;
+        auto wait = start - next.queued;
+        used[cls] += busy;
+        const auto& deadline = policies[cls].deadline;
+        schedulerMetrics(cls).record(
+            wait, busy, (deadline.count() != 0) && (wait > deadline));
+
+        boost::asio::post(hwIo, [this]() { runNext(); });
+    }
+
+    /** @brief Runs job on the I/O thread, rearming a timer on failure. The
+     *         retry is counted against the priority class, and against
+     *         the register or mtd device whose transaction failed.
+     */
+    template <typename Job, typename Handler>
+    void attempt(Job job, Handler handler, const unsigned int retries,
+                 const Priority priority, WorkGuard guard)
+    {
+        TransactionMetrics::lastFailure() = nullptr;
+        int ret = job();
+        if ((ret == 0) || (retries == 0))
+        {
+            complete(std::move(handler), ret);
+            return;
+        }
+
+        phosphor::logging::log<phosphor::logging::level::WARNING>(
+            "PFR: Mailbox transaction failed, retrying....",
+            phosphor::logging::entry("COUNT=%d", retries));
+        schedulerMetrics(static_cast<size_t>(priority)).recordRetry();
+        if (TransactionMetrics* failed = TransactionMetrics::lastFailure())
+        {
+            failed->recordRetry();
+        }
+        // Timed on the D-Bus thread, the retry is queued on expiry even
+        // while a transaction holds the I/O thread.
+        auto timer = std::make_shared<boost::asio::steady_timer>(dbusIo);
+        timer->expires_after(retryDelay);
+        timer->async_wait([this, timer, job = std::move(job),
+                           handler = std::move(handler), retries, priority,
+                           guard = std::move(guard)](
+                              const boost::system::error_code&) mutable {
+            // Queued again, other transactions may run in between.
+            schedule(priority, [this, job = std::move(job),
+                                handler = std::move(handler), retries,
+                                priority, guard = std::move(guard)]() mutable {
+                attempt(std::move(job), std::move(handler), retries - 1,
+                        priority, std::move(guard));
+            });
+        });
+    }
+
+  public:
+    IoExecutor() = delete;
+    IoExecutor(const IoExecutor&) = delete;
+    IoExecutor& operator=(const IoExecutor&) = delete;
+    IoExecutor(IoExecutor&&) = delete;
+    IoExecutor& operator=(IoExecutor&&) = delete;
+
+    /** @brief Starts the hardware I/O thread
+     *
+     *  @param[in] io           - io_context of the D-Bus connection
+     */
+    explicit IoExecutor(boost::asio::io_context& io) :
+        dbusIo(io), work(boost::asio::make_work_guard(hwIo)),
+        thread([this]() { hwIo.run(); })
+    {}
+
+    ~IoExecutor()
+    {
+        work.reset();
+        hwIo.stop();
+        thread.join();
+    }
+
+    /** @brief Runs job on the I/O thread, handler gets its result on the
+     *         D-Bus thread.
+     *
+     *  @param[in] job          - Callable doing the hardware access
+     *  @param[in] handler      - Callable taking the job result
+     *  @param[in] priority     - Priority class of the transaction
+     */
+    template <typename Job, typename Handler>
+    void post(Job&& job, Handler&& handler,
+              const Priority priority = Priority::background)
+    {
+        // Work guard keeps the D-Bus io_context alive until completion.
+        schedule(priority, [this, job = std::forward<Job>(job),
+                            handler = std::forward<Handler>(handler),
+                            guard = boost::asio::make_work_guard(
+                                dbusIo)]() mutable {
+            complete(std::move(handler), job());
+        });
+    }
+
+    /** @brief Like post, for jobs returning 0 on success. Failed jobs are
+     *         retried after a timer without blocking the I/O thread.
+     *
+     *  @param[in] job          - Callable returning 0 on success
+     *  @param[in] handler      - Callable taking the last job result
+     *  @param[in] retries      - Number of retries after first failure
+     *  @param[in] priority     - Priority class of the transaction
+     */
+    template <typename Job, typename Handler>
+    void postWithRetry(Job&& job, Handler&& handler,
+                       const unsigned int retries,
+                       const Priority priority = Priority::background)
+    {
+        schedule(priority, [this, job = std::forward<Job>(job),
+                            handler = std::forward<Handler>(handler), retries,
+                            priority, guard = boost::asio::make_work_guard(
+                                          dbusIo)]() mutable {
+            attempt(std::move(job), std::move(handler), retries, priority,
+                    std::move(guard));
+        });
+    }
+
+    /** @brief Runs job on the I/O thread, suspending the calling D-Bus
+     *         coroutine until it completes.
+     *
+     *  @param[in] job          - Callable doing the hardware access
+     *  @param[in] yield        - Coroutine of the D-Bus method handler
+     *  @param[in] priority     - Priority class of the transaction
+     *  @return job result
+     */
+    template <typename Job>
+    auto run(Job&& job, boost::asio::yield_context yield,
+             const Priority priority = Priority::background)
+    {
+        using Result = decltype(job());
+        return boost::asio::async_initiate<boost::asio::yield_context,
+                                           void(Result)>(
+            [this, priority](auto handler, auto job) {
+                post(std::move(job), std::move(handler), priority);
+            },
+            yield, std::forward<Job>(job));
+    }
+
+    /** @brief Coroutine flavour of postWithRetry
+     *
+     *  @param[in] job          - Callable returning 0 on success
+     *  @param[in] retries      - Number of retries after first failure
+     *  @param[in] yield        - Coroutine of the D-Bus method handler
+     *  @param[in] priority     - Priority class of the transaction
+     *  @return last job result
+     */
+    template <typename Job>
+    int runWithRetry(Job&& job, const unsigned int retries,
+                     boost::asio::yield_context yield,
+                     const Priority priority = Priority::background)
+    {
+        return boost::asio::async_initiate<boost::asio::yield_context,
+                                           void(int)>(
+            [this, retries, priority](auto handler, auto job) {
+                postWithRetry(std::move(job), std::move(handler), retries,
+                              priority);
+            },
+            yield, std::forward<Job>(job));
+    }
+};
+
+} // namespace pfr
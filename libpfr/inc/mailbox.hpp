@@ -0,0 +1,161 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include "file.hpp"
+#include "metrics.hpp"
+#include "transport.hpp"
+
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace pfr
+{
+
+/** @class MailboxSession
+ *  @brief SMBus mailbox transport. Keeps the CPLD mailbox device open
+ *         across register accesses.
+ */
+class MailboxSession : public MailboxTransport
+{
+  private:
+    /** @brief open device, empty until first access or after an error */
+    std::unique_ptr<I2CFile> cpldDev;
+    int i2cBus;
+    int slaveAddr;
+    /** @brief metrics of the device at i2cBus and slaveAddr */
+    MailboxMetrics* metrics;
+    /** @brief serializes D-Bus and I/O thread accesses */
+    std::mutex mutex;
+
+    /** @brief I2C device name as in sysfs, e.g. 4-0038 */
+    static std::string deviceName(const int& bus, const int& addr)
+    {
+        std::array<char, 32> name = {};
+        std::snprintf(name.data(), name.size(), "%d-%04x", bus, addr);
+        return name.data();
+    }
+
+    /** @brief Runs func on the open device, opening it if needed. On any
+     *         error the device is closed and the exception is rethrown.
+     *
+     *  @param[in] offset       - Register the metrics are recorded on
+     *  @param[in] func         - Callable taking I2CFile&
+     */
+    template <typename Func>
+    auto transact(const uint8_t offset, Func&& func)
+        -> decltype(func(std::declval<I2CFile&>()))
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Timed under the lock, waiting for the other thread is not bus
+        // latency.
+        TransactionTimer timer((*metrics)[offset]);
+        if (!cpldDev)
+        {
+            cpldDev = std::make_unique<I2CFile>(i2cBus, slaveAddr,
+                                                O_RDWR | O_CLOEXEC);
+        }
+        try
+        {
+            return func(*cpldDev);
+        }
+        catch (const std::exception&)
+        {
+            // Bus may be wedged or the device gone. Reopen on next access.
+            cpldDev.reset();
+            throw;
+        }
+    }
+
+  public:
+    MailboxSession() = delete;
+    MailboxSession(const MailboxSession&) = delete;
+    MailboxSession& operator=(const MailboxSession&) = delete;
+    MailboxSession(MailboxSession&&) = delete;
+    MailboxSession& operator=(MailboxSession&&) = delete;
+
+    /** @brief Creates a session, device is opened on first access
+     *
+     *  @param[in] i2cBus       - I2C bus number
+     *  @param[in] slaveAddr    - I2C slave address
+     */
+    MailboxSession(const int& i2cBus, const int& slaveAddr) :
+        i2cBus(i2cBus), slaveAddr(slaveAddr),
+        metrics(&mailboxMetrics(deviceName(i2cBus, slaveAddr)))
+    {}
+
+    /** @brief Updates the bus and address. Open device is dropped only
+     *         when either of them changes.
+     *
+     *  @param[in] bus          - I2C bus number
+     *  @param[in] addr         - I2C slave address
+     */
+    void setAddress(const int& bus, const int& addr) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if ((bus == i2cBus) && (addr == slaveAddr))
+        {
+            return;
+        }
+        i2cBus = bus;
+        slaveAddr = addr;
+        metrics = &mailboxMetrics(deviceName(bus, addr));
+        cpldDev.reset();
+    }
+
+    /** @brief Closes the device, next access reopens it */
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cpldDev.reset();
+    }
+
+    uint8_t readByte(const uint8_t offset) override
+    {
+        return transact(offset, [offset](I2CFile& dev) {
+            return dev.i2cReadByteData(offset);
+        });
+    }
+
+    void readBlock(const uint8_t offset, const uint8_t length,
+                   uint8_t* value) override
+    {
+        transact(offset, [&](I2CFile& dev) {
+            return dev.i2cReadBlockData(offset, length, value);
+        });
+    }
+
+    void writeByte(const uint8_t offset, const uint8_t value) override
+    {
+        transact(offset,
+                 [&](I2CFile& dev) { dev.i2cWriteByteData(offset, value); });
+    }
+
+    void writeBlock(const uint8_t offset, const uint8_t length,
+                    const uint8_t* value) override
+    {
+        transact(offset, [&](I2CFile& dev) {
+            dev.i2cWriteBlockData(offset, length, value);
+        });
+    }
+};
+
+} // namespace pfr
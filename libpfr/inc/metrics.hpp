@@ -0,0 +1,251 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <string>
+
+namespace pfr
+{
+
+// Bucket i counts latencies of [2^i, 2^(i+1)) usec. The first bucket
+// also holds anything faster, the last anything slower.
+static constexpr size_t latencyBuckets = 20;
+
+/** Copy of one TransactionMetrics */
+struct TransactionStats
+{
+    uint64_t count = 0;
+    // Failures retried by IoExecutor.
+    uint64_t retries = 0;
+    uint64_t failures = 0;
+    std::array<uint64_t, latencyBuckets> latency = {0};
+};
+
+/** @class TransactionMetrics
+ *  @brief Counters of one mailbox register or mtd device. Updated without
+ *         locks from any thread.
+ */
+class TransactionMetrics
+{
+  public:
+    void record(const std::chrono::steady_clock::duration& elapsed,
+                const bool failed)
+    {
+        auto usec =
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+                .count();
+        size_t bucket =
+            (usec > 1) ? std::bit_width(static_cast<uint64_t>(usec)) - 1 : 0;
+        if (bucket >= latencyBuckets)
+        {
+            bucket = latencyBuckets - 1;
+        }
+
+        count.fetch_add(1, std::memory_order_relaxed);
+        latency[bucket].fetch_add(1, std::memory_order_relaxed);
+        if (failed)
+        {
+            failures.fetch_add(1, std::memory_order_relaxed);
+            lastFailure() = this;
+        }
+    }
+
+    void recordRetry()
+    {
+        retries.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /** @brief Target of the last failed transaction on this thread, for
+     *         IoExecutor to count its retry against. Cleared by the caller.
+     */
+    static TransactionMetrics*& lastFailure()
+    {
+        thread_local TransactionMetrics* metrics = nullptr;
+        return metrics;
+    }
+
+    TransactionStats stats() const
+    {
+        TransactionStats copy;
+        copy.count = count.load(std::memory_order_relaxed);
+        copy.retries = retries.load(std::memory_order_relaxed);
+        copy.failures = failures.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < latencyBuckets; i++)
+        {
+            copy.latency[i] = latency[i].load(std::memory_order_relaxed);
+        }
+        return copy;
+    }
+
+    void reset()
+    {
+        count = 0;
+        retries = 0;
+        failures = 0;
+        for (auto& bucket : latency)
+        {
+            bucket = 0;
+        }
+    }
+
+  private:
+    std::atomic<uint64_t> count = 0;
+    std::atomic<uint64_t> retries = 0;
+    std::atomic<uint64_t> failures = 0;
+    std::array<std::atomic<uint64_t>, latencyBuckets> latency = {};
+};
+
+/** @class TransactionTimer
+ *  @brief Times the transaction in its scope. It is recorded as failed
+ *         when an exception unwinds the scope.
+ */
+class TransactionTimer
+{
+  public:
+    explicit TransactionTimer(TransactionMetrics& metrics_) :
+        metrics(metrics_), start(std::chrono::steady_clock::now()),
+        exceptions(std::uncaught_exceptions())
+    {}
+
+    TransactionTimer(const TransactionTimer&) = delete;
+    TransactionTimer& operator=(const TransactionTimer&) = delete;
+
+    ~TransactionTimer()
+    {
+        metrics.record(std::chrono::steady_clock::now() - start,
+                       std::uncaught_exceptions() > exceptions);
+    }
+
+  private:
+    TransactionMetrics& metrics;
+    std::chrono::steady_clock::time_point start;
+    int exceptions;
+};
+
+// Transaction scheduler priority classes, see IoExecutor.
+static constexpr size_t priorityClasses = 3;
+
+/** Copy of one SchedulerMetrics */
+struct SchedulerStats
+{
+    uint64_t count = 0;
+    // Transactions started later than the deadline of their class.
+    uint64_t deadlineMisses = 0;
+    // Failed transactions queued again by IoExecutor.
+    uint64_t retries = 0;
+    uint64_t maxWaitUsec = 0;
+    uint64_t busyUsec = 0;
+};
+
+/** @class SchedulerMetrics
+ *  @brief Counters of one transaction priority class, summed over all bus
+ *         queues. Updated without locks from any thread.
+ */
+class SchedulerMetrics
+{
+  public:
+    void record(const std::chrono::steady_clock::duration& wait,
+                const std::chrono::steady_clock::duration& busy,
+                const bool missed)
+    {
+        auto waitUsec = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(wait)
+                .count());
+        count.fetch_add(1, std::memory_order_relaxed);
+        busyUsec.fetch_add(
+            std::chrono::duration_cast<std::chrono::microseconds>(busy)
+                .count(),
+            std::memory_order_relaxed);
+        if (missed)
+        {
+            deadlineMisses.fetch_add(1, std::memory_order_relaxed);
+        }
+        uint64_t max = maxWaitUsec.load(std::memory_order_relaxed);
+        while ((waitUsec > max) &&
+               !maxWaitUsec.compare_exchange_weak(max, waitUsec,
+                                                  std::memory_order_relaxed))
+        {}
+    }
+
+    void recordRetry()
+    {
+        retries.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    SchedulerStats stats() const
+    {
+        SchedulerStats copy;
+        copy.count = count.load(std::memory_order_relaxed);
+        copy.deadlineMisses = deadlineMisses.load(std::memory_order_relaxed);
+        copy.retries = retries.load(std::memory_order_relaxed);
+        copy.maxWaitUsec = maxWaitUsec.load(std::memory_order_relaxed);
+        copy.busyUsec = busyUsec.load(std::memory_order_relaxed);
+        return copy;
+    }
+
+    void reset()
+    {
+        count = 0;
+        deadlineMisses = 0;
+        retries = 0;
+        maxWaitUsec = 0;
+        busyUsec = 0;
+    }
+
+  private:
+    std::atomic<uint64_t> count = 0;
+    std::atomic<uint64_t> deadlineMisses = 0;
+    std::atomic<uint64_t> retries = 0;
+    std::atomic<uint64_t> maxWaitUsec = 0;
+    std::atomic<uint64_t> busyUsec = 0;
+};
+
+/** Metrics of every register of one CPLD mailbox, block reads count on
+ *  their first register.
+ */
+using MailboxMetrics = std::array<TransactionMetrics, 256>;
+
+/** @brief Metrics of the mailbox of a CPLD, created on first use
+ *
+ *  @param[in] device       - I2C device name, e.g. 4-0038
+ */
+MailboxMetrics& mailboxMetrics(const std::string& device);
+
+/** @brief Metrics of an mtd device, created on first use */
+TransactionMetrics& mtdMetrics(const std::string& mtdDev);
+
+/** @brief Registers accessed since the last reset, by mailbox device */
+std::map<std::string, std::map<uint8_t, TransactionStats>> mailboxStats();
+
+/** @brief mtd devices accessed since the last reset */
+std::map<std::string, TransactionStats> mtdStats();
+
+/** @brief Metrics of a transaction priority class */
+SchedulerMetrics& schedulerMetrics(const size_t priorityClass);
+
+std::array<SchedulerStats, priorityClasses> schedulerStats();
+
+void resetMetrics();
+
+} // namespace pfr
@@ -0,0 +1,197 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace pfr
+{
+
+// PFR MTD devices
+static constexpr const char* bmcActiveImgPfmMTDDev = "/dev/mtd/pfm";
+static constexpr const char* bmcRecoveryImgMTDDev = "/dev/mtd/rc-image";
+
+using ByteSpan = std::span<const uint8_t>;
+
+/** @class MtdImage
+ *  @brief Read only view of the start of an mtd device. Mapped where the
+ *         mtd driver supports mmap, read into memory otherwise.
+ */
+class MtdImage
+{
+  public:
+    /** @brief Opens the view. Throws std::runtime_error on errors.
+     *
+     *  @param[in] mtdDev       - MTD device path
+     *  @param[in] maxLength    - Bytes to view from the device start
+     */
+    MtdImage(const std::string& mtdDev, const size_t maxLength);
+    ~MtdImage();
+
+    MtdImage(const MtdImage&) = delete;
+    MtdImage& operator=(const MtdImage&) = delete;
+
+    ByteSpan data() const
+    {
+        return view;
+    }
+
+  private:
+    void* map = nullptr;
+    size_t mapLength = 0;
+    std::vector<uint8_t> buffer;
+    ByteSpan view;
+};
+
+/** Signature block 0 of a signed PFM or capsule */
+struct SignatureBlock
+{
+    uint32_t pcLength;
+    uint32_t pcType;
+};
+
+struct PfmHeader
+{
+    uint8_t svn;
+    uint8_t bkcVersion;
+    uint8_t majorVersion;
+    uint8_t minorVersion;
+    ByteSpan oemData;
+    uint32_t length;
+};
+
+struct PfmSpiRegion
+{
+    uint8_t protectionMask;
+    uint16_t hashInfo;
+    uint32_t startAddress;
+    uint32_t endAddress;
+    ByteSpan sha256;
+    ByteSpan sha384;
+};
+
+struct PfmSmbusRule
+{
+    uint8_t busId;
+    uint8_t ruleId;
+    uint8_t address;
+    ByteSpan commandWhitelist;
+};
+
+struct PfmFvmAddress
+{
+    uint16_t fvType;
+    uint32_t address;
+};
+
+using PfmDefinition = std::variant<PfmSpiRegion, PfmSmbusRule, PfmFvmAddress>;
+
+/** @class PfmParser
+ *  @brief Decodes a signed PFM in place. Definitions are decoded one at a
+ *         time and refer into the image, which must outlive them. Throws
+ *         std::runtime_error on malformed input.
+ */
+class PfmParser
+{
+  public:
+    /** @brief Decodes the signature block and PFM header
+     *
+     *  @param[in] signedPfm    - Signed PFM, signature blocks first
+     */
+    explicit PfmParser(ByteSpan signedPfm);
+
+    const SignatureBlock& signature() const
+    {
+        return sigBlock;
+    }
+
+    const PfmHeader& header() const
+    {
+        return pfmHeader;
+    }
+
+    /** @brief Size of the signed PFM, signature blocks included */
+    size_t size() const;
+
+    /** @brief Decodes the next definition, std::nullopt after the last */
+    std::optional<PfmDefinition> next();
+
+  private:
+    SignatureBlock sigBlock;
+    PfmHeader pfmHeader;
+    ByteSpan pfm;
+    size_t offset;
+};
+
+/** Compression structure header of a recovery capsule */
+struct PbcHeader
+{
+    uint32_t version;
+    uint32_t pageSize;
+    uint32_t patternSize;
+    uint32_t patternContent;
+    uint32_t bitmapBits;
+    uint32_t payloadLength;
+    ByteSpan activeBitmap;
+    ByteSpan compressionBitmap;
+    size_t payloadOffset;
+};
+
+/** @class RecoveryCapsule
+ *  @brief Decodes a compressed recovery capsule in place: capsule
+ *         signature, signed PFM and compression structure. The payload
+ *         is located but not read.
+ */
+class RecoveryCapsule
+{
+  public:
+    explicit RecoveryCapsule(ByteSpan capsule);
+
+    const SignatureBlock& signature() const
+    {
+        return sigBlock;
+    }
+
+    const PbcHeader& pbc() const
+    {
+        return pbcHeader;
+    }
+
+    /** @brief New parser over the capsule PFM */
+    PfmParser pfm() const
+    {
+        return PfmParser(signedPfm);
+    }
+
+    /** @brief Pages written to flash on recovery */
+    size_t activePages() const;
+
+    /** @brief Pages carried in the payload */
+    size_t compressedPages() const;
+
+  private:
+    SignatureBlock sigBlock;
+    ByteSpan signedPfm;
+    PbcHeader pbcHeader;
+};
+
+} // namespace pfr
@@ -19,11 +19,17 @@
 #include <boost/asio.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
+#include <array>
+#include <bitset>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace pfr
 {
 
+class MailboxTransport;
+
 enum class ImageType
 {
     cpldActive,
@@ -47,17 +53,70 @@ enum class ActionType
     readRoTRev
 };
 
+// CPLD mailbox status registers 0x00 - 0x0A, in register order. Filled by
+// a single block read so all fields are from the same moment.
+struct MailboxSnapshot
+{
+    uint8_t rotId;
+    uint8_t rotRev;
+    uint8_t rotSvn;
+    uint8_t platformState;
+    uint8_t recoveryCount;
+    uint8_t recoveryReason;
+    uint8_t panicCount;
+    uint8_t panicReason;
+    uint8_t majorError;
+    uint8_t minorError;
+    uint8_t provisioningStatus;
+};
+
+// Copy of CPLD mailbox registers. Each run of adjacent registers is read
+// with one block read.
+struct MailboxRegisters
+{
+    std::array<uint8_t, 256> value = {0};
+    std::bitset<256> valid;
+};
+
 std::string toHexString(const uint8_t val);
 std::string getFirmwareVersion(const ImageType& imgType);
 int getProvisioningStatus(bool& ufmLocked, bool& ufmProvisioned,
                           bool& ufmSupport);
 int getPlatformState(uint8_t& state);
 int readCpldReg(const ActionType& action, uint8_t& value);
+int readMailboxSnapshot(MailboxSnapshot& snapshot);
 std::string readCPLDVersion();
 int setBMCBootCompleteChkPoint(const uint8_t checkPoint);
-void init(std::shared_ptr<sdbusplus::asio::connection> conn,
-          bool& i2cConfigLoaded);
+void setMailboxAddress(const uint64_t i2cBus, const uint64_t address);
+// Bus and address the mailbox accessors above use.
+void getMailboxAddress(uint64_t& i2cBus, uint64_t& address);
 int setBMCBusy(bool setValue);
 int getMBRegister(uint32_t regAddr, uint8_t& mailBoxReply);
+// Consecutive mailbox registers, in SMBus block transfers.
+int readMBRegisters(const uint32_t offset, const uint32_t count,
+                    std::vector<uint8_t>& data);
+int writeMBRegisters(const uint32_t offset, const std::vector<uint8_t>& data);
+int readGPIOInput(const std::string& name, uint8_t& value);
+void setMailboxTransport(std::unique_ptr<MailboxTransport> transport);
+// SMBus transport of another PFR CPLD, for multi-node platforms.
+std::unique_ptr<MailboxTransport> makeMailboxTransport(const uint64_t i2cBus,
+                                                       const uint64_t address);
+int readMailboxSnapshot(MailboxTransport& transport,
+                        MailboxSnapshot& snapshot);
+
+// Registers behind the status and the CPLD held firmware versions.
+std::vector<uint8_t> statusAndVersionRegisters();
+int readMailboxRegisters(const std::vector<uint8_t>& offsets,
+                         MailboxRegisters& regs);
+int readMailboxRegisters(MailboxTransport& transport,
+                         const std::vector<uint8_t>& offsets,
+                         MailboxRegisters& regs);
+// Same as the accessors above, from registers read earlier. Only the BMC
+// versions, held in SPI flash, are read.
+std::string getFirmwareVersion(const ImageType& imgType,
+                               const MailboxRegisters& regs);
+int getProvisioningStatus(const MailboxRegisters& regs, bool& ufmLocked,
+                          bool& ufmProvisioned, bool& ufmSupport);
+int getPlatformState(const MailboxRegisters& regs, uint8_t& state);
 
 } // namespace pfr
@@ -0,0 +1,118 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include "transport.hpp"
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace pfr
+{
+
+/** @class SimulatedCpld
+ *  @brief In-process CPLD mailbox register file for running the service
+ *         without PFR hardware.
+ *
+ *  Script file format, one directive per line, numbers in C notation:
+ *      # comment
+ *      latency <microseconds>          - delay added to every transaction
+ *      nak <percent>                   - chance a transaction fails
+ *      fault <count>                   - every transaction after <count>
+ *                                        fails, as with a wedged bus
+ *      set <reg> <value>               - initial register value
+ *      at <milliseconds> <reg> <value> - register value changes at the
+ *                                        given time after start
+ */
+class SimulatedCpld : public MailboxTransport
+{
+  public:
+    SimulatedCpld();
+    SimulatedCpld(const SimulatedCpld&) = delete;
+    SimulatedCpld& operator=(const SimulatedCpld&) = delete;
+
+    /** @brief Loads a script file. Throws std::runtime_error on errors.
+     *
+     *  @param[in] path         - Script file path
+     */
+    void loadScript(const std::string& path);
+
+    void setLatency(const std::chrono::microseconds& delay)
+    {
+        latency = delay;
+    }
+
+    void setNakPercent(const unsigned int percent)
+    {
+        nakPercent = percent;
+    }
+
+    void setFaultAfter(const size_t count)
+    {
+        faultAfter = count;
+    }
+
+    void setRegister(const uint8_t offset, const uint8_t value)
+    {
+        regs[offset] = value;
+    }
+
+    /** @brief Schedules a register change relative to start time
+     *
+     *  @param[in] at           - Time after start
+     *  @param[in] offset       - Register offset
+     *  @param[in] value        - New value
+     */
+    void addStep(const std::chrono::milliseconds& at, const uint8_t offset,
+                 const uint8_t value);
+
+    uint8_t readByte(const uint8_t offset) override;
+    void readBlock(const uint8_t offset, const uint8_t length,
+                   uint8_t* value) override;
+    void writeByte(const uint8_t offset, const uint8_t value) override;
+    void writeBlock(const uint8_t offset, const uint8_t length,
+                    const uint8_t* value) override;
+
+  private:
+    struct Step
+    {
+        std::chrono::milliseconds at;
+        uint8_t offset;
+        uint8_t value;
+    };
+
+    /** @brief Applies latency, scripted changes and injected failures */
+    void transaction();
+
+    /** @brief serializes D-Bus and I/O thread accesses */
+    std::mutex mutex;
+    std::array<uint8_t, 256> regs = {0};
+    std::vector<Step> script;
+    size_t nextStep = 0;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::microseconds latency{0};
+    unsigned int nakPercent = 0;
+    size_t faultAfter = 0;
+    size_t txCount = 0;
+    std::minstd_rand rng;
+};
+
+} // namespace pfr
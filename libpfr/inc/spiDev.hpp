@@ -16,10 +16,16 @@
 
 #pragma once
 
+#include "metrics.hpp"
+
+#include <fcntl.h>
 #include <stdio.h>
+#include <unistd.h>
 
 #include <cstring>
 #include <experimental/filesystem>
+#include <stdexcept>
+#include <string>
 
 namespace pfr
 {
@@ -32,6 +38,7 @@ class SPIDev
   private:
     /** @brief handler for operating on file */
     int fd = -1;
+    TransactionMetrics& metrics;
 
   public:
     SPIDev() = delete;
@@ -40,12 +47,14 @@ class SPIDev
     SPIDev(SPIDev&&) = delete;
     SPIDev& operator=(SPIDev&&) = delete;
 
-    /** @brief Opens spi(mtd) device file
+    /** @brief Opens spi(mtd) device file, read-only so that closing it
+     *         does not look like a flash update to inotify watchers
      *
      *  @param[in] devNo       - MTD device number
      */
     SPIDev(const std::string& spiDev) :
-        fd(open(spiDev.c_str(), O_RDWR | O_CLOEXEC))
+        fd(open(spiDev.c_str(), O_RDONLY | O_CLOEXEC)),
+        metrics(mtdMetrics(spiDev))
     {
         if (fd < 0)
         {
@@ -64,14 +73,10 @@ class SPIDev
     void spiReadData(const uint32_t startAddr, const size_t dataLen,
                      void* dataRes)
     {
-        if (lseek(fd, startAddr, SEEK_SET) < 0)
-        {
-            std::string msg = "Failed to do lseek on mtd device. errno=" +
-                              std::string(std::strerror(errno));
-            throw std::runtime_error(msg);
-        }
-
-        if (read(fd, dataRes, dataLen) != dataLen)
+        TransactionTimer timer(metrics);
+        // Positioned read, one syscall and no shared file offset.
+        if (pread(fd, dataRes, dataLen, startAddr) !=
+            static_cast<ssize_t>(dataLen))
         {
             std::string msg = "Failed to read on mtd device. errno=" +
                               std::string(std::strerror(errno));
@@ -0,0 +1,73 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace pfr
+{
+
+/** @class MailboxTransport
+ *  @brief Access to the CPLD mailbox register file. Implementations
+ *         throw std::runtime_error on any transaction failure.
+ */
+class MailboxTransport
+{
+  public:
+    virtual ~MailboxTransport() = default;
+
+    /** @brief Reads one mailbox register
+     *
+     *  @param[in] offset       - Register offset
+     *  @return register value
+     */
+    virtual uint8_t readByte(const uint8_t offset) = 0;
+
+    /** @brief Reads consecutive mailbox registers
+     *
+     *  @param[in] offset       - First register offset
+     *  @param[in] length       - Number of registers
+     *  @param[out] value       - Buffer of at least length bytes
+     */
+    virtual void readBlock(const uint8_t offset, const uint8_t length,
+                           uint8_t* value) = 0;
+
+    /** @brief Writes one mailbox register
+     *
+     *  @param[in] offset       - Register offset
+     *  @param[in] value        - Data
+     */
+    virtual void writeByte(const uint8_t offset, const uint8_t value) = 0;
+
+    /** @brief Writes consecutive mailbox registers
+     *
+     *  @param[in] offset       - First register offset
+     *  @param[in] length       - Number of registers
+     *  @param[in] value        - Buffer of at least length bytes
+     */
+    virtual void writeBlock(const uint8_t offset, const uint8_t length,
+                            const uint8_t* value) = 0;
+
+    /** @brief Updates the bus location of the CPLD, if applicable
+     *
+     *  @param[in] bus          - I2C bus number
+     *  @param[in] addr         - I2C slave address
+     */
+    virtual void setAddress(const int& /*bus*/, const int& /*addr*/) {}
+};
+
+} // namespace pfr
@@ -0,0 +1,52 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace pfr
+{
+
+struct RegionVerifyResult
+{
+    uint32_t startAddress;
+    uint32_t endAddress;
+    bool passed;
+};
+
+/** Called from worker threads with <bytes hashed, total bytes> */
+using VerifyProgressHandler = std::function<void(uint64_t, uint64_t)>;
+
+/** @brief Verifies a recovery capsule against the hashes of its own PFM.
+ *         Each hashed SPI region is rebuilt from the capsule bitmaps and
+ *         payload, as the CPLD would write it, and hashed. Regions are
+ *         spread over worker threads. Throws std::runtime_error if the
+ *         capsule can not be decoded or read.
+ *
+ *  @param[in] mtdDev       - Capsule mtd device, e.g. /dev/mtd/rc-image
+ *  @param[in] threads      - Worker threads, 0 for one per CPU
+ *  @param[in] progress     - Progress handler, may be empty
+ *  @return per-region results in PFM order
+ */
+std::vector<RegionVerifyResult>
+    verifyRecoveryImage(const std::string& mtdDev, unsigned int threads,
+                        const VerifyProgressHandler& progress);
+
+} // namespace pfr
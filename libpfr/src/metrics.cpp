@@ -0,0 +1,153 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "metrics.hpp"
+
+#include <memory>
+#include <mutex>
+
+namespace pfr
+{
+
+static std::array<SchedulerMetrics, priorityClasses> priorityClassMetrics;
+
+// Devices are only added, entries stay valid for recorders holding them.
+template <typename Metrics>
+struct DeviceMetrics
+{
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<Metrics>> devices;
+};
+
+// Function local, the mailbox transports are created during static
+// initialization of other translation units.
+static DeviceMetrics<MailboxMetrics>& mailboxRegistry()
+{
+    static DeviceMetrics<MailboxMetrics> registry;
+    return registry;
+}
+
+static DeviceMetrics<TransactionMetrics>& mtdRegistry()
+{
+    static DeviceMetrics<TransactionMetrics> registry;
+    return registry;
+}
+
+MailboxMetrics& mailboxMetrics(const std::string& device)
+{
+    auto& registry = mailboxRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto& metrics = registry.devices[device];
+    if (!metrics)
+    {
+        metrics = std::make_unique<MailboxMetrics>();
+    }
+    return *metrics;
+}
+
+TransactionMetrics& mtdMetrics(const std::string& mtdDev)
+{
+    auto& registry = mtdRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto& metrics = registry.devices[mtdDev];
+    if (!metrics)
+    {
+        metrics = std::make_unique<TransactionMetrics>();
+    }
+    return *metrics;
+}
+
+std::map<std::string, std::map<uint8_t, TransactionStats>> mailboxStats()
+{
+    std::map<std::string, std::map<uint8_t, TransactionStats>> stats;
+    auto& registry = mailboxRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const auto& [device, metrics] : registry.devices)
+    {
+        std::map<uint8_t, TransactionStats> registers;
+        for (size_t offset = 0; offset < metrics->size(); offset++)
+        {
+            TransactionStats copy = (*metrics)[offset].stats();
+            if (copy.count != 0)
+            {
+                registers.emplace(static_cast<uint8_t>(offset), copy);
+            }
+        }
+        if (!registers.empty())
+        {
+            stats.emplace(device, std::move(registers));
+        }
+    }
+    return stats;
+}
+
+SchedulerMetrics& schedulerMetrics(const size_t priorityClass)
+{
+    return priorityClassMetrics.at(priorityClass);
+}
+
+std::array<SchedulerStats, priorityClasses> schedulerStats()
+{
+    std::array<SchedulerStats, priorityClasses> stats;
+    for (size_t i = 0; i < priorityClasses; i++)
+    {
+        stats[i] = priorityClassMetrics[i].stats();
+    }
+    return stats;
+}
+
+std::map<std::string, TransactionStats> mtdStats()
+{
+    std::map<std::string, TransactionStats> stats;
+    auto& registry = mtdRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const auto& [mtdDev, metrics] : registry.devices)
+    {
+        TransactionStats copy = metrics->stats();
+        if (copy.count != 0)
+        {
+            stats.emplace(mtdDev, copy);
+        }
+    }
+    return stats;
+}
+
+void resetMetrics()
+{
+    for (auto& metrics : priorityClassMetrics)
+    {
+        metrics.reset();
+    }
+    {
+        auto& registry = mailboxRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (auto& [device, metrics] : registry.devices)
+        {
+            for (auto& reg : *metrics)
+            {
+                reg.reset();
+            }
+        }
+    }
+    auto& registry = mtdRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (auto& [mtdDev, metrics] : registry.devices)
+    {
+        metrics->reset();
+    }
+}
+
+} // namespace pfr
@@ -0,0 +1,306 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "pfm.hpp"
+
+#include "metrics.hpp"
+
+#include <fcntl.h>
+#include <mtd/mtd-user.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace pfr
+{
+
+// Signature blocks 0 and 1 in front of every signed structure.
+static constexpr size_t signatureSize = 0x400;
+static constexpr uint32_t block0Tag = 0xB6EAFD19;
+static constexpr size_t block0PcLengthOffset = 0x04;
+static constexpr size_t block0PcTypeOffset = 0x08;
+
+// PFM header
+static constexpr uint32_t pfmTag = 0x02B3CE1D;
+static constexpr size_t pfmSvnOffset = 0x04;
+static constexpr size_t pfmBkcOffset = 0x05;
+static constexpr size_t pfmMajorOffset = 0x06;
+static constexpr size_t pfmMinorOffset = 0x07;
+static constexpr size_t pfmOemDataOffset = 0x0C;
+static constexpr size_t pfmOemDataSize = 16;
+static constexpr size_t pfmLengthOffset = 0x1C;
+static constexpr size_t pfmHeaderSize = 0x20;
+
+// PFM definitions, first byte is the type. Erased flash ends the list.
+static constexpr uint8_t spiRegionDef = 0x01;
+static constexpr uint8_t smbusRuleDef = 0x02;
+static constexpr uint8_t fvmAddressDef = 0x03;
+static constexpr uint8_t erasedDef = 0xFF;
+
+static constexpr size_t spiRegionSize = 0x10;
+static constexpr uint16_t sha256Present = 0x01;
+static constexpr uint16_t sha384Present = 0x02;
+static constexpr size_t sha256Size = 32;
+static constexpr size_t sha384Size = 48;
+static constexpr size_t smbusWhitelistSize = 32;
+static constexpr size_t smbusRuleSize = 0x08 + smbusWhitelistSize;
+static constexpr size_t fvmAddressSize = 0x0C;
+
+// Capsule compression structure header
+static constexpr uint32_t pbcTag = 0x5F504243;
+static constexpr size_t pbcHeaderSize = 0x80;
+
+// Bounds checked sub-span
+static ByteSpan field(ByteSpan data, const size_t offset, const size_t length)
+{
+    if ((offset > data.size()) || (length > (data.size() - offset)))
+    {
+        throw std::runtime_error("Truncated PFR image at offset " +
+                                 std::to_string(offset));
+    }
+    return data.subspan(offset, length);
+}
+
+static uint16_t le16(ByteSpan data, const size_t offset)
+{
+    ByteSpan bytes = field(data, offset, sizeof(uint16_t));
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+static uint32_t le32(ByteSpan data, const size_t offset)
+{
+    ByteSpan bytes = field(data, offset, sizeof(uint32_t));
+    return static_cast<uint32_t>(bytes[0]) | (bytes[1] << 8) |
+           (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+static SignatureBlock parseSignature(ByteSpan data)
+{
+    field(data, 0, signatureSize);
+    if (le32(data, 0) != block0Tag)
+    {
+        throw std::runtime_error("Invalid signature block tag");
+    }
+    return SignatureBlock{le32(data, block0PcLengthOffset),
+                          le32(data, block0PcTypeOffset)};
+}
+
+MtdImage::MtdImage(const std::string& mtdDev, const size_t maxLength)
+{
+    int fd = open(mtdDev.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Unable to open mtd device. errno=" +
+                                 std::string(std::strerror(errno)));
+    }
+
+    size_t devSize = 0;
+    mtd_info_t mtdInfo;
+    struct stat st;
+    if (ioctl(fd, MEMGETINFO, &mtdInfo) == 0)
+    {
+        devSize = mtdInfo.size;
+    }
+    else if (fstat(fd, &st) == 0)
+    {
+        // Plain file, e.g. an image copied off the flash.
+        devSize = st.st_size;
+    }
+    size_t length = std::min(devSize, maxLength);
+
+    map = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if ((length != 0) && (map != MAP_FAILED))
+    {
+        mapLength = length;
+        view = ByteSpan(static_cast<const uint8_t*>(map), length);
+        close(fd);
+        return;
+    }
+
+    // SPI NOR mtd devices usually can not be mapped.
+    map = nullptr;
+    TransactionTimer timer(mtdMetrics(mtdDev));
+    buffer.resize(length);
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t ret = pread(fd, buffer.data() + done, length - done, done);
+        if (ret <= 0)
+        {
+            std::string msg = "Failed to read on mtd device. errno=" +
+                              std::string(std::strerror(errno));
+            close(fd);
+            throw std::runtime_error(msg);
+        }
+        done += ret;
+    }
+    close(fd);
+    view = ByteSpan(buffer);
+}
+
+MtdImage::~MtdImage()
+{
+    if (map != nullptr)
+    {
+        munmap(map, mapLength);
+    }
+}
+
+PfmParser::PfmParser(ByteSpan signedPfm)
+{
+    sigBlock = parseSignature(signedPfm);
+    ByteSpan body = signedPfm.subspan(signatureSize);
+
+    if (le32(body, 0) != pfmTag)
+    {
+        throw std::runtime_error("Invalid PFM tag");
+    }
+    pfmHeader.svn = field(body, pfmSvnOffset, 1)[0];
+    pfmHeader.bkcVersion = field(body, pfmBkcOffset, 1)[0];
+    pfmHeader.majorVersion = field(body, pfmMajorOffset, 1)[0];
+    pfmHeader.minorVersion = field(body, pfmMinorOffset, 1)[0];
+    pfmHeader.oemData = field(body, pfmOemDataOffset, pfmOemDataSize);
+    pfmHeader.length = le32(body, pfmLengthOffset);
+    if ((pfmHeader.length < pfmHeaderSize) ||
+        (sigBlock.pcLength < pfmHeader.length))
+    {
+        throw std::runtime_error("Invalid PFM length");
+    }
+
+    // Signed content is the PFM padded to the signing block size.
+    field(body, 0, sigBlock.pcLength);
+    pfm = field(body, 0, pfmHeader.length);
+    offset = pfmHeaderSize;
+}
+
+size_t PfmParser::size() const
+{
+    return signatureSize + sigBlock.pcLength;
+}
+
+std::optional<PfmDefinition> PfmParser::next()
+{
+    if ((offset >= pfm.size()) || (pfm[offset] == erasedDef))
+    {
+        return std::nullopt;
+    }
+
+    ByteSpan def = pfm.subspan(offset);
+    switch (def[0])
+    {
+        case spiRegionDef:
+        {
+            PfmSpiRegion region;
+            region.protectionMask = field(def, 0x01, 1)[0];
+            region.hashInfo = le16(def, 0x02);
+            region.startAddress = le32(def, 0x08);
+            region.endAddress = le32(def, 0x0C);
+            size_t hashOffset = spiRegionSize;
+            if (region.hashInfo & sha256Present)
+            {
+                region.sha256 = field(def, hashOffset, sha256Size);
+                hashOffset += sha256Size;
+            }
+            if (region.hashInfo & sha384Present)
+            {
+                region.sha384 = field(def, hashOffset, sha384Size);
+                hashOffset += sha384Size;
+            }
+            offset += hashOffset;
+            return region;
+        }
+        case smbusRuleDef:
+        {
+            PfmSmbusRule rule;
+            rule.busId = field(def, 0x05, 1)[0];
+            rule.ruleId = field(def, 0x06, 1)[0];
+            rule.address = field(def, 0x07, 1)[0];
+            rule.commandWhitelist = field(def, 0x08, smbusWhitelistSize);
+            offset += smbusRuleSize;
+            return rule;
+        }
+        case fvmAddressDef:
+        {
+            PfmFvmAddress fvm;
+            fvm.fvType = le16(def, 0x01);
+            fvm.address = le32(def, 0x08);
+            offset += fvmAddressSize;
+            return fvm;
+        }
+        default:
+            // Size of an unknown definition is unknown, nothing after it
+            // can be decoded.
+            throw std::runtime_error("Unknown PFM definition type " +
+                                     std::to_string(def[0]) +
+                                     " at offset " + std::to_string(offset));
+    }
+}
+
+RecoveryCapsule::RecoveryCapsule(ByteSpan capsule)
+{
+    sigBlock = parseSignature(capsule);
+
+    // The signed PFM follows the capsule signature.
+    ByteSpan body = capsule.subspan(signatureSize);
+    signedPfm = body.first(PfmParser(body).size());
+
+    ByteSpan pbc = body.subspan(signedPfm.size());
+    if (le32(pbc, 0) != pbcTag)
+    {
+        throw std::runtime_error("Invalid capsule compression tag");
+    }
+    pbcHeader.version = le32(pbc, 0x04);
+    pbcHeader.pageSize = le32(pbc, 0x08);
+    pbcHeader.patternSize = le32(pbc, 0x0C);
+    pbcHeader.patternContent = le32(pbc, 0x10);
+    pbcHeader.bitmapBits = le32(pbc, 0x14);
+    pbcHeader.payloadLength = le32(pbc, 0x18);
+
+    size_t bitmapSize = pbcHeader.bitmapBits / 8;
+    pbcHeader.activeBitmap = field(pbc, pbcHeaderSize, bitmapSize);
+    pbcHeader.compressionBitmap =
+        field(pbc, pbcHeaderSize + bitmapSize, bitmapSize);
+    pbcHeader.payloadOffset = signatureSize + signedPfm.size() +
+                              pbcHeaderSize + (2 * bitmapSize);
+}
+
+static size_t countBits(ByteSpan bitmap)
+{
+    size_t count = 0;
+    for (const uint8_t byte : bitmap)
+    {
+        count += std::popcount(byte);
+    }
+    return count;
+}
+
+size_t RecoveryCapsule::activePages() const
+{
+    return countBits(pbcHeader.activeBitmap);
+}
+
+size_t RecoveryCapsule::compressedPages() const
+{
+    return countBits(pbcHeader.compressionBitmap);
+}
+
+} // namespace pfr
@@ -17,23 +17,36 @@
 #include "pfr.hpp"
 
 #include "file.hpp"
+#include "format.hpp"
+#include "mailbox.hpp"
+#include "pfm.hpp"
 #include "spiDev.hpp"
+#include "transport.hpp"
+
+#include <sys/inotify.h>
+#include <unistd.h>
 
 #include <gpiod.hpp>
 
-#include <iomanip>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
 #include <iostream>
-#include <sstream>
+#include <mutex>
 
 namespace pfr
 {
 
-using GetSubTreeType = std::vector<
-    std::pair<std::string,
-              std::vector<std::pair<std::string, std::vector<std::string>>>>>;
+static constexpr int defaultI2cBusNumber = 4;
+static constexpr int defaultI2cSlaveAddress = 56;
 
-static int i2cBusNumber = 4;
-static int i2cSlaveAddress = 56;
+// CPLD mailbox transport, SMBus unless replaced by setMailboxTransport.
+static std::unique_ptr<MailboxTransport> cpldMailbox =
+    std::make_unique<MailboxSession>(defaultI2cBusNumber,
+                                     defaultI2cSlaveAddress);
+static std::atomic<uint64_t> mailboxI2cBus = defaultI2cBusNumber;
+static std::atomic<uint64_t> mailboxAddress = defaultI2cSlaveAddress;
 
 // CPLD mailbox registers
 static constexpr uint8_t pfrROTId = 0x00;
@@ -63,10 +76,6 @@ static constexpr uint8_t afmRecoveryMinorVersion = 0x79;
 static constexpr uint8_t ufmLockedMask = (0x1 << 0x04);
 static constexpr uint8_t ufmProvisionedMask = (0x1 << 0x05);
 
-// PFR MTD devices
-static constexpr const char* bmcActiveImgPfmMTDDev = "/dev/mtd/pfm";
-static constexpr const char* bmcRecoveryImgMTDDev = "/dev/mtd/rc-image";
-
 // PFM offset in full image
 static constexpr const uint32_t pfmBaseOffsetInImage = 0x400;
 
@@ -74,127 +83,76 @@ static constexpr const uint32_t pfmBaseOffsetInImage = 0x400;
 static constexpr const uint32_t verOffsetInPFM = 0x406;
 static constexpr const uint32_t buildNumOffsetInPFM = 0x40C;
 static constexpr const uint32_t buildHashOffsetInPFM = 0x40D;
+static constexpr const size_t buildHashSize = 3;
+static constexpr const size_t pfmVersionBlockSize =
+    buildHashOffsetInPFM + buildHashSize - verOffsetInPFM;
 
-bool exceptionFlag = true;
-extern bool bmcBootCompleteChkPointDone;
-extern bool unProvChkPointStatus;
+// Accessors run on both the D-Bus and the hardware I/O thread.
+std::atomic<bool> exceptionFlag = true;
 
-void init(std::shared_ptr<sdbusplus::asio::connection> conn,
-          bool& i2cConfigLoaded)
+void setMailboxTransport(std::unique_ptr<MailboxTransport> transport)
 {
-    conn->async_method_call(
-        [conn, &i2cConfigLoaded](const boost::system::error_code ec,
-                                 const GetSubTreeType& resp) {
-            if (ec || resp.size() != 1)
-            {
-                return;
-            }
-            if (resp[0].second.begin() == resp[0].second.end())
-                return;
-            const std::string& objPath = resp[0].first;
-            const std::string& serviceName = resp[0].second.begin()->first;
+    cpldMailbox = std::move(transport);
+}
 
-            const std::string match = "Baseboard/PFR";
-            if (boost::ends_with(objPath, match))
-            {
-                // PFR object found.. check for PFR support
-                conn->async_method_call(
-                    [objPath, serviceName, conn, &i2cConfigLoaded](
-                        boost::system::error_code ec,
-                        const std::vector<std::pair<
-                            std::string, std::variant<std::string, uint64_t>>>&
-                            propertiesList) {
-                        if (ec)
-                        {
-                            phosphor::logging::log<
-                                phosphor::logging::level::ERR>(
-                                "Error to Get PFR properties.",
-                                phosphor::logging::entry("MSG=%s",
-                                                         ec.message().c_str()));
-                            return;
-                        }
-
-                        const uint64_t* i2cBus = nullptr;
-                        const uint64_t* address = nullptr;
-
-                        for (const auto& [propName, propVariant] :
-                             propertiesList)
-                        {
-                            if (propName == "Address")
-                            {
-                                address = std::get_if<uint64_t>(&propVariant);
-                            }
-                            else if (propName == "Bus")
-                            {
-                                i2cBus = std::get_if<uint64_t>(&propVariant);
-                            }
-                        }
-
-                        if ((address == nullptr) || (i2cBus == nullptr))
-                        {
-                            phosphor::logging::log<
-                                phosphor::logging::level::ERR>(
-                                "Unable to read the pfr properties");
-                            return;
-                        }
-
-                        i2cBusNumber = static_cast<int>(*i2cBus);
-                        i2cSlaveAddress = static_cast<int>(*address);
-                        i2cConfigLoaded = true;
-                    },
-                    serviceName, objPath, "org.freedesktop.DBus.Properties",
-                    "GetAll", "xyz.openbmc_project.Configuration.PFR");
-            }
-        },
-        "xyz.openbmc_project.ObjectMapper",
-        "/xyz/openbmc_project/object_mapper",
-        "xyz.openbmc_project.ObjectMapper", "GetSubTree",
-        "/xyz/openbmc_project/inventory/system", 0,
-        std::array<const char*, 1>{"xyz.openbmc_project.Configuration.PFR"});
-    return;
+std::unique_ptr<MailboxTransport> makeMailboxTransport(const uint64_t i2cBus,
+                                                       const uint64_t address)
+{
+    return std::make_unique<MailboxSession>(static_cast<int>(i2cBus),
+                                            static_cast<int>(address));
+}
+
+void setMailboxAddress(const uint64_t i2cBus, const uint64_t address)
+{
+    cpldMailbox->setAddress(static_cast<int>(i2cBus),
+                            static_cast<int>(address));
+    mailboxI2cBus = i2cBus;
+    mailboxAddress = address;
+}
+
+void getMailboxAddress(uint64_t& i2cBus, uint64_t& address)
+{
+    i2cBus = mailboxI2cBus;
+    address = mailboxAddress;
 }
 
 std::string toHexString(const uint8_t val)
 {
-    std::stringstream stream;
-    stream << std::setfill('0') << std::setw(2) << std::hex
-           << static_cast<int>(val);
-    return stream.str();
+    return std::string(hexDigits[val].data(), hexDigits[val].size());
 }
 
-static std::string readCPLDHash()
+static constexpr uint8_t CPLDHashLength = 32;
+
+// Versions are built in fixed buffers. The short ones fit the std::string
+// small buffer and are returned without a heap allocation.
+using HashString = FixedString<2 * CPLDHashLength>;
+// <RoTRev.RoTSVN>-<RoT HASH>
+using CPLDVersionString =
+    FixedString<MajorMinorString::capacity() + 1 + HashString::capacity()>;
+
+static HashString formatCPLDHash(const uint8_t* hashValue)
 {
-    std::stringstream hashStrStream;
-    static constexpr uint8_t hashLength = 32;
-    std::array<uint8_t, hashLength> hashValue = {0};
+    HashString hash;
+    hash.appendHex(hashValue, CPLDHashLength);
+    return hash;
+}
+
+static HashString readCPLDHash()
+{
+    std::array<uint8_t, CPLDHashLength> hashValue = {0};
     try
     {
-        I2CFile cpldDev(i2cBusNumber, i2cSlaveAddress, O_RDWR | O_CLOEXEC);
-        if (cpldDev.i2cReadBlockData(CPLDHashRegStart, hashLength,
-                                     hashValue.data()))
-        {
-            for (const auto& i : hashValue)
-            {
-                hashStrStream << std::setfill('0') << std::setw(2) << std::hex
-                              << static_cast<int>(i);
-            }
-        }
-        else
-        {
-            // read failed
-            phosphor::logging::log<phosphor::logging::level::ERR>(
-                "Failed to read CPLD Hash string");
-            return "";
-        }
+        cpldMailbox->readBlock(CPLDHashRegStart, CPLDHashLength,
+                               hashValue.data());
     }
     catch (const std::exception& e)
     {
         phosphor::logging::log<phosphor::logging::level::ERR>(
             "Exception caught in readCPLDHash.",
             phosphor::logging::entry("MSG=%s", e.what()));
-        return "";
+        return {};
     }
-    return hashStrStream.str();
+    return formatCPLDHash(hashValue.data());
 }
 
 static std::string readVersionFromCPLD(const uint8_t majorReg,
@@ -202,13 +160,9 @@ static std::string readVersionFromCPLD(const uint8_t majorReg,
 {
     try
     {
-        I2CFile cpldDev(i2cBusNumber, i2cSlaveAddress, O_RDWR | O_CLOEXEC);
-        uint8_t majorVer = cpldDev.i2cReadByteData(majorReg);
-        uint8_t minorVer = cpldDev.i2cReadByteData(minorReg);
-        // Major and Minor versions should be binary encoded strings.
-        std::string version =
-            std::to_string(majorVer) + "." + std::to_string(minorVer);
-        return version;
+        uint8_t majorVer = cpldMailbox->readByte(majorReg);
+        uint8_t minorVer = cpldMailbox->readByte(minorReg);
+        return formatVersion(majorVer, minorVer).str();
     }
     catch (const std::exception& e)
     {
@@ -219,12 +173,72 @@ static std::string readVersionFromCPLD(const uint8_t majorReg,
     }
 }
 
+// BMC version parsed from the PFM, re-read only once the mtd device has
+// been written to.
+struct PfmVersionCache
+{
+    int inotifyFd = -1;
+    bool valid = false;
+    std::string version;
+};
+
+static void watchMtdDev(PfmVersionCache& cache, const std::string& mtdDev)
+{
+    cache.inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (cache.inotifyFd < 0)
+    {
+        return;
+    }
+    if (inotify_add_watch(cache.inotifyFd, mtdDev.c_str(),
+                          IN_MODIFY | IN_CLOSE_WRITE) < 0)
+    {
+        phosphor::logging::log<phosphor::logging::level::WARNING>(
+            "Unable to watch mtd device, BMC version is not cached.",
+            phosphor::logging::entry("MSG=%s", std::strerror(errno)));
+        close(cache.inotifyFd);
+        cache.inotifyFd = -1;
+    }
+}
+
+// Drains pending events, returns true if the device changed since the
+// last call or can no longer be watched.
+static bool mtdDevChanged(PfmVersionCache& cache)
+{
+    if (cache.inotifyFd < 0)
+    {
+        return true;
+    }
+
+    bool changed = false;
+    alignas(inotify_event) std::array<char, 256> events;
+    ssize_t len = 0;
+    while ((len = read(cache.inotifyFd, events.data(), events.size())) > 0)
+    {
+        changed = true;
+        for (ssize_t i = 0; i < len;)
+        {
+            auto event = reinterpret_cast<const inotify_event*>(&events[i]);
+            if (event->mask & IN_IGNORED)
+            {
+                // Device node removed, watch it again on the next read.
+                close(cache.inotifyFd);
+                cache.inotifyFd = -1;
+                return true;
+            }
+            i += sizeof(inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
+
 static std::string readBMCVersionFromSPI(const ImageType& imgType)
 {
+    static std::mutex cacheMutex;
+    static std::array<PfmVersionCache, 2> caches;
+
     std::string mtdDev;
-    uint32_t verOffset = verOffsetInPFM;
-    uint32_t bldNumOffset = buildNumOffsetInPFM;
-    uint32_t bldHashOffset = buildHashOffsetInPFM;
+    uint32_t pfmOffset = 0;
+    size_t cacheIndex = 0;
 
     if (imgType == ImageType::bmcActive)
     {
@@ -236,9 +250,8 @@ static std::string readBMCVersionFromSPI(const ImageType& imgType)
         // For Recovery image, PFM is part of compressed Image
         // at offset 0x400.
         mtdDev = bmcRecoveryImgMTDDev;
-        verOffset += pfmBaseOffsetInImage;
-        bldNumOffset += pfmBaseOffsetInImage;
-        bldHashOffset += pfmBaseOffsetInImage;
+        pfmOffset = pfmBaseOffsetInImage;
+        cacheIndex = 1;
     }
     else
     {
@@ -247,19 +260,27 @@ static std::string readBMCVersionFromSPI(const ImageType& imgType)
         return "";
     }
 
-    uint8_t buildNo = 0;
-    std::array<uint8_t, 2> ver;
-    std::array<uint8_t, 3> buildHash;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    PfmVersionCache& cache = caches[cacheIndex];
+    if (!mtdDevChanged(cache) && cache.valid)
+    {
+        return cache.version;
+    }
+    cache.valid = false;
+    if (cache.inotifyFd < 0)
+    {
+        // Watch before reading, so a write racing the read is noticed.
+        watchMtdDev(cache, mtdDev);
+    }
+
+    // Version, build number and build hash in one read of the PFM.
+    std::array<uint8_t, pfmVersionBlockSize> block;
 
     try
     {
         SPIDev spiDev(mtdDev);
-        spiDev.spiReadData(verOffset, ver.size(),
-                           reinterpret_cast<void*>(ver.data()));
-        spiDev.spiReadData(bldNumOffset, sizeof(buildNo),
-                           reinterpret_cast<void*>(&buildNo));
-        spiDev.spiReadData(bldHashOffset, buildHash.size(),
-                           reinterpret_cast<void*>(buildHash.data()));
+        spiDev.spiReadData(verOffsetInPFM + pfmOffset, block.size(),
+                           reinterpret_cast<void*>(block.data()));
     }
     catch (const std::exception& e)
     {
@@ -269,14 +290,23 @@ static std::string readBMCVersionFromSPI(const ImageType& imgType)
         return "";
     }
 
+    const uint8_t* ver = &block[0];
+    const uint8_t buildNo = block[buildNumOffsetInPFM - verOffsetInPFM];
+    const uint8_t* buildHash = &block[buildHashOffsetInPFM - verOffsetInPFM];
+
     // Version format: <major>.<minor>-<build bum>-g<build hash>
     // Example: 0.11-7-g1e5c2d
     // Major, minor and build numberare BCD encoded.
-    std::string version =
-        std::to_string(ver[0]) + "." + std::to_string(ver[1]) + "-" +
-        std::to_string(buildNo) + "-g" + toHexString(buildHash[0]) +
-        toHexString(buildHash[1]) + toHexString(buildHash[2]);
-    return version;
+    static_assert(buildHashSize == 3);
+    BMCVersionString version = formatBMCVersion(ver[0], ver[1], buildNo,
+                                                buildHash);
+
+    // Formatted without allocating. Versions over 15 characters outgrow
+    // the std::string small buffer, the cache and the copy returned then
+    // allocate.
+    cache.version.assign(version.view());
+    cache.valid = (cache.inotifyFd >= 0);
+    return cache.version;
 }
 
 static bool getGPIOInput(const std::string& name, gpiod::line& gpioLine,
@@ -319,6 +349,16 @@ static bool getGPIOInput(const std::string& name, gpiod::line& gpioLine,
     return true;
 }
 
+int readGPIOInput(const std::string& name, uint8_t& value)
+{
+    gpiod::line gpioLine;
+    if (!getGPIOInput(name, gpioLine, &value))
+    {
+        return -1;
+    }
+    return 0;
+}
+
 std::string readCPLDVersion()
 {
     std::string svnRoTHash = "";
@@ -328,8 +368,7 @@ std::string readCPLDVersion()
     uint8_t cpldRoTValue = 0;
     try
     {
-        I2CFile cpldDev(i2cBusNumber, i2cSlaveAddress, O_RDWR | O_CLOEXEC);
-        cpldRoTValue = cpldDev.i2cReadByteData(pfrROTId);
+        cpldRoTValue = cpldMailbox->readByte(pfrROTId);
     }
     catch (const std::exception& e)
     {
@@ -340,12 +379,12 @@ std::string readCPLDVersion()
 
     if (cpldRoTValue == pfrRoTValue)
     {
-        // read RoT Rev and RoT SVN
-        std::string rotRevSVN = readVersionFromCPLD(cpldROTVersion, cpldROTSvn);
-
-        // read CPLD hash
-        std::string cpldHash = readCPLDHash();
-        version = rotRevSVN + "-" + cpldHash;
+        // read RoT Rev and RoT SVN, then the CPLD hash
+        CPLDVersionString rotVersion;
+        rotVersion.append(readVersionFromCPLD(cpldROTVersion, cpldROTSvn))
+            .append('-')
+            .append(readCPLDHash().view());
+        version = rotVersion.str();
     }
     else
     {
@@ -410,9 +449,8 @@ int getProvisioningStatus(bool& ufmLocked, bool& ufmProvisioned,
 {
     try
     {
-        I2CFile cpldDev(i2cBusNumber, i2cSlaveAddress, O_RDWR | O_CLOEXEC);
-        uint8_t provStatus = cpldDev.i2cReadByteData(provisioningStatus);
-        uint8_t pfrRoT = cpldDev.i2cReadByteData(pfrROTId);
+        uint8_t provStatus = cpldMailbox->readByte(provisioningStatus);
+        uint8_t pfrRoT = cpldMailbox->readByte(pfrROTId);
         ufmLocked = (provStatus & ufmLockedMask);
         ufmProvisioned = (provStatus & ufmProvisionedMask);
         ufmSupport = (pfrRoT & pfrRoTValue);
@@ -431,8 +469,7 @@ int getPlatformState(uint8_t& state)
 {
     try
     {
-        I2CFile cpldDev(i2cBusNumber, i2cSlaveAddress, O_RDWR | O_CLOEXEC);
-        state = cpldDev.i2cReadByteData(platformState);
+        state = cpldMailbox->readByte(platformState);
 
         return 0;
     }
@@ -481,15 +518,13 @@ int readCpldReg(const ActionType& action, uint8_t& value)
 
     try
     {
-        I2CFile cpldDev(i2cBusNumber, i2cSlaveAddress, O_RDWR | O_CLOEXEC);
-        value = cpldDev.i2cReadByteData(cpldReg);
+        value = cpldMailbox->readByte(cpldReg);
         return 0;
     }
     catch (const std::exception& e)
     {
-        if (exceptionFlag)
+        if (exceptionFlag.exchange(false))
         {
-            exceptionFlag = false;
             phosphor::logging::log<phosphor::logging::level::ERR>(
                 "Exception caught in readCpldReg.",
                 phosphor::logging::entry("MSG=%s", e.what()));
@@ -498,6 +533,210 @@ int readCpldReg(const ActionType& action, uint8_t& value)
     }
 }
 
+int readMailboxSnapshot(MailboxSnapshot& snapshot)
+{
+    return readMailboxSnapshot(*cpldMailbox, snapshot);
+}
+
+int readMailboxSnapshot(MailboxTransport& transport, MailboxSnapshot& snapshot)
+{
+    static_assert(sizeof(MailboxSnapshot) == (provisioningStatus + 1),
+                  "MailboxSnapshot must mirror registers 0x00 - 0x0A");
+    std::array<uint8_t, sizeof(MailboxSnapshot)> regs = {0};
+    try
+    {
+        transport.readBlock(pfrROTId, regs.size(), regs.data());
+    }
+    catch (const std::exception& e)
+    {
+        if (exceptionFlag.exchange(false))
+        {
+            phosphor::logging::log<phosphor::logging::level::ERR>(
+                "Exception caught in readMailboxSnapshot.",
+                phosphor::logging::entry("MSG=%s", e.what()));
+        }
+        return -1;
+    }
+
+    snapshot.rotId = regs[pfrROTId];
+    snapshot.rotRev = regs[cpldROTVersion];
+    snapshot.rotSvn = regs[cpldROTSvn];
+    snapshot.platformState = regs[platformState];
+    snapshot.recoveryCount = regs[recoveryCount];
+    snapshot.recoveryReason = regs[lastRecoveryReason];
+    snapshot.panicCount = regs[panicEventCount];
+    snapshot.panicReason = regs[panicEventReason];
+    snapshot.majorError = regs[majorErrorCode];
+    snapshot.minorError = regs[minorErrorCode];
+    snapshot.provisioningStatus = regs[provisioningStatus];
+    return 0;
+}
+
+// Largest SMBus block transfer
+static constexpr size_t maxBlockRead = 32;
+
+std::vector<uint8_t> statusAndVersionRegisters()
+{
+    std::vector<uint8_t> offsets;
+    // RoT ID through provisioning status, one block like the snapshot.
+    for (uint8_t reg = pfrROTId; reg <= provisioningStatus; reg++)
+    {
+        offsets.push_back(reg);
+    }
+    for (uint8_t reg = 0; reg < CPLDHashLength; reg++)
+    {
+        offsets.push_back(CPLDHashRegStart + reg);
+    }
+    for (uint8_t reg :
+         {pchActiveMajorVersion, pchActiveMinorVersion, pchRecoveryMajorVersion,
+          pchRecoveryMinorVersion, afmActiveMajorVersion, afmActiveMinorVersion,
+          afmRecoveryMajorVersion, afmRecoveryMinorVersion})
+    {
+        offsets.push_back(reg);
+    }
+    return offsets;
+}
+
+int readMailboxRegisters(const std::vector<uint8_t>& offsets,
+                         MailboxRegisters& regs)
+{
+    return readMailboxRegisters(*cpldMailbox, offsets, regs);
+}
+
+int readMailboxRegisters(MailboxTransport& transport,
+                         const std::vector<uint8_t>& offsets,
+                         MailboxRegisters& regs)
+{
+    std::vector<uint8_t> sorted = offsets;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    try
+    {
+        // Only adjacent registers are merged, registers in between may
+        // be FIFOs that must not be read.
+        for (size_t first = 0; first < sorted.size();)
+        {
+            size_t last = first + 1;
+            while ((last < sorted.size()) &&
+                   (sorted[last] == (sorted[last - 1] + 1)) &&
+                   ((last - first) < maxBlockRead))
+            {
+                last++;
+            }
+
+            uint8_t offset = sorted[first];
+            size_t length = last - first;
+            if (length == 1)
+            {
+                regs.value[offset] = transport.readByte(offset);
+            }
+            else
+            {
+                transport.readBlock(offset, length, &regs.value[offset]);
+            }
+            for (size_t reg = offset; reg < (offset + length); reg++)
+            {
+                regs.valid.set(reg);
+            }
+            first = last;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "Exception caught in readMailboxRegisters.",
+            phosphor::logging::entry("MSG=%s", e.what()));
+        return -1;
+    }
+    return 0;
+}
+
+static std::string versionFromRegisters(const MailboxRegisters& regs,
+                                        const uint8_t majorReg,
+                                        const uint8_t minorReg)
+{
+    if (!regs.valid[majorReg] || !regs.valid[minorReg])
+    {
+        return "";
+    }
+    return formatVersion(regs.value[majorReg], regs.value[minorReg]).str();
+}
+
+std::string getFirmwareVersion(const ImageType& imgType,
+                               const MailboxRegisters& regs)
+{
+    switch (imgType)
+    {
+        case (ImageType::cpldActive):
+        {
+            if (!regs.valid[pfrROTId] ||
+                (regs.value[pfrROTId] != pfrRoTValue) ||
+                !regs.valid[CPLDHashRegStart + CPLDHashLength - 1])
+            {
+                return "unknown";
+            }
+            CPLDVersionString version;
+            version
+                .append(
+                    versionFromRegisters(regs, cpldROTVersion, cpldROTSvn))
+                .append('-')
+                .append(formatCPLDHash(&regs.value[CPLDHashRegStart]).view());
+            return version.str();
+        }
+        case (ImageType::cpldRecovery):
+        {
+            return versionFromRegisters(regs, cpldROTVersion, cpldROTSvn);
+        }
+        case (ImageType::biosActive):
+        {
+            return versionFromRegisters(regs, pchActiveMajorVersion,
+                                        pchActiveMinorVersion);
+        }
+        case (ImageType::biosRecovery):
+        {
+            return versionFromRegisters(regs, pchRecoveryMajorVersion,
+                                        pchRecoveryMinorVersion);
+        }
+        case (ImageType::afmActive):
+        {
+            return versionFromRegisters(regs, afmActiveMajorVersion,
+                                        afmActiveMinorVersion);
+        }
+        case (ImageType::afmRecovery):
+        {
+            return versionFromRegisters(regs, afmRecoveryMajorVersion,
+                                        afmRecoveryMinorVersion);
+        }
+        default:
+            return getFirmwareVersion(imgType);
+    }
+}
+
+int getProvisioningStatus(const MailboxRegisters& regs, bool& ufmLocked,
+                          bool& ufmProvisioned, bool& ufmSupport)
+{
+    if (!regs.valid[provisioningStatus] || !regs.valid[pfrROTId])
+    {
+        return -1;
+    }
+    uint8_t provStatus = regs.value[provisioningStatus];
+    ufmLocked = (provStatus & ufmLockedMask);
+    ufmProvisioned = (provStatus & ufmProvisionedMask);
+    ufmSupport = (regs.value[pfrROTId] & pfrRoTValue);
+    return 0;
+}
+
+int getPlatformState(const MailboxRegisters& regs, uint8_t& state)
+{
+    if (!regs.valid[platformState])
+    {
+        return -1;
+    }
+    state = regs.value[platformState];
+    return 0;
+}
+
 int setBMCBootCompleteChkPoint(const uint8_t checkPoint)
 {
     uint8_t bmcBootCheckpointReg = bmcBootCheckpoint;
@@ -507,8 +746,7 @@ int setBMCBootCompleteChkPoint(const uint8_t checkPoint)
     uint8_t cpldRoTRev = 0;
     try
     {
-        I2CFile cpldDev(i2cBusNumber, i2cSlaveAddress, O_RDWR | O_CLOEXEC);
-        cpldRoTRev = cpldDev.i2cReadByteData(cpldROTVersion);
+        cpldRoTRev = cpldMailbox->readByte(cpldROTVersion);
     }
     catch (const std::exception& e)
     {
@@ -526,18 +764,9 @@ int setBMCBootCompleteChkPoint(const uint8_t checkPoint)
 
     try
     {
-        I2CFile cpldDev(i2cBusNumber, i2cSlaveAddress, O_RDWR | O_CLOEXEC);
-        cpldDev.i2cWriteByteData(bmcBootCheckpointReg, checkPoint);
+        cpldMailbox->writeByte(bmcBootCheckpointReg, checkPoint);
         phosphor::logging::log<phosphor::logging::level::INFO>(
             "Successfully set the PFR CPLD checkpoint 9.");
-        bmcBootCompleteChkPointDone = true;
-        if (unProvChkPointStatus)
-        {
-            unProvChkPointStatus = false;
-            phosphor::logging::log<phosphor::logging::level::INFO>(
-                "PFR is not provisioned, hence exit the service.");
-            std::exit(EXIT_SUCCESS);
-        }
         return 0;
     }
     catch (const std::exception& e)
@@ -553,8 +782,7 @@ static bool setMBRegister(uint32_t regOffset, uint8_t regValue)
 {
     try
     {
-        I2CFile mailDev(i2cBusNumber, i2cSlaveAddress, O_RDWR | O_CLOEXEC);
-        mailDev.i2cWriteByteData(regOffset, regValue);
+        cpldMailbox->writeByte(regOffset, regValue);
         return true;
     }
     catch (const std::exception& e)
@@ -603,9 +831,7 @@ int getMBRegister(uint32_t regAddr, uint8_t& mailBoxReply)
     // Read from PFR CPLD's mailbox register
     try
     {
-        I2CFile mailReadDev(i2cBusNumber, i2cSlaveAddress, O_RDWR | O_CLOEXEC);
-
-        mailBoxReply = mailReadDev.i2cReadByteData(regAddr);
+        mailBoxReply = cpldMailbox->readByte(regAddr);
     }
     catch (const std::exception& e)
     {
@@ -617,4 +843,69 @@ int getMBRegister(uint32_t regAddr, uint8_t& mailBoxReply)
     return 0;
 }
 
+// Mailbox register file size, transfers must not wrap around its end.
+static constexpr size_t mailboxSize = 256;
+
+static bool validRange(const uint32_t offset, const size_t count)
+{
+    return (count != 0) && (offset < mailboxSize) &&
+           (count <= (mailboxSize - offset));
+}
+
+int readMBRegisters(const uint32_t offset, const uint32_t count,
+                    std::vector<uint8_t>& data)
+{
+    if (!validRange(offset, count))
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "Invalid mailbox register range.");
+        return -1;
+    }
+
+    data.resize(count);
+    try
+    {
+        for (size_t done = 0; done < count; done += maxBlockRead)
+        {
+            size_t length = std::min(count - done, maxBlockRead);
+            cpldMailbox->readBlock(offset + done, length, &data[done]);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "Exception caught in mailbox block reading.",
+            phosphor::logging::entry("MSG=%s", e.what()));
+        return -1;
+    }
+    return 0;
+}
+
+int writeMBRegisters(const uint32_t offset, const std::vector<uint8_t>& data)
+{
+    if (!validRange(offset, data.size()))
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "Invalid mailbox register range.");
+        return -1;
+    }
+
+    try
+    {
+        for (size_t done = 0; done < data.size(); done += maxBlockRead)
+        {
+            size_t length = std::min(data.size() - done, maxBlockRead);
+            cpldMailbox->writeBlock(offset + done, length, &data[done]);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "Exception caught in mailbox block writing.",
+            phosphor::logging::entry("MSG=%s", e.what()));
+        return -1;
+    }
+    return 0;
+}
+
 } // namespace pfr
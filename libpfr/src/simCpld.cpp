@@ -0,0 +1,185 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "simCpld.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace pfr
+{
+
+// Register defaults of a provisioned RoT Rev 2 CPLD in T0 boot complete.
+static constexpr uint8_t simRoTId = 0xDE;
+static constexpr uint8_t simRoTRev = 0x02;
+static constexpr uint8_t simPlatformState = 0x0E;
+static constexpr uint8_t simProvisioningStatus = 0x30;
+
+SimulatedCpld::SimulatedCpld() :
+    start(std::chrono::steady_clock::now()), rng(std::random_device{}())
+{
+    regs[0x00] = simRoTId;
+    regs[0x01] = simRoTRev;
+    regs[0x03] = simPlatformState;
+    regs[0x0A] = simProvisioningStatus;
+}
+
+void SimulatedCpld::addStep(const std::chrono::milliseconds& at,
+                            const uint8_t offset, const uint8_t value)
+{
+    auto it = std::upper_bound(
+        script.begin() + nextStep, script.end(), at,
+        [](const auto& time, const Step& step) { return time < step.at; });
+    script.insert(it, Step{at, offset, value});
+}
+
+static unsigned long parseNumber(std::istringstream& stream)
+{
+    std::string token;
+    if (!(stream >> token))
+    {
+        throw std::runtime_error("Missing argument");
+    }
+    return std::stoul(token, nullptr, 0);
+}
+
+void SimulatedCpld::loadScript(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        throw std::runtime_error("Unable to open CPLD simulation script.");
+    }
+
+    std::string line;
+    size_t lineNo = 0;
+    while (std::getline(file, line))
+    {
+        lineNo++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream stream(line);
+        std::string directive;
+        if (!(stream >> directive))
+        {
+            continue;
+        }
+
+        try
+        {
+            if (directive == "latency")
+            {
+                setLatency(std::chrono::microseconds(parseNumber(stream)));
+            }
+            else if (directive == "nak")
+            {
+                setNakPercent(parseNumber(stream));
+            }
+            else if (directive == "fault")
+            {
+                setFaultAfter(parseNumber(stream));
+            }
+            else if (directive == "set")
+            {
+                uint8_t offset = parseNumber(stream);
+                setRegister(offset, parseNumber(stream));
+            }
+            else if (directive == "at")
+            {
+                std::chrono::milliseconds at(parseNumber(stream));
+                uint8_t offset = parseNumber(stream);
+                addStep(at, offset, parseNumber(stream));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown directive " + directive);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            throw std::runtime_error("CPLD simulation script line " +
+                                     std::to_string(lineNo) + ": " +
+                                     e.what());
+        }
+    }
+}
+
+void SimulatedCpld::transaction()
+{
+    if (latency.count())
+    {
+        std::this_thread::sleep_for(latency);
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    while ((nextStep < script.size()) && (script[nextStep].at <= elapsed))
+    {
+        regs[script[nextStep].offset] = script[nextStep].value;
+        nextStep++;
+    }
+
+    txCount++;
+    if (faultAfter && (txCount > faultAfter))
+    {
+        throw std::runtime_error("Simulated CPLD bus fault");
+    }
+    if (nakPercent && ((rng() % 100) < nakPercent))
+    {
+        throw std::runtime_error("Simulated CPLD NAK");
+    }
+}
+
+uint8_t SimulatedCpld::readByte(const uint8_t offset)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    transaction();
+    return regs[offset];
+}
+
+void SimulatedCpld::readBlock(const uint8_t offset, const uint8_t length,
+                              uint8_t* value)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    transaction();
+    for (size_t i = 0; i < length; i++)
+    {
+        // Register address wraps like the CPLD auto-increment does.
+        value[i] = regs[(offset + i) % regs.size()];
+    }
+}
+
+void SimulatedCpld::writeByte(const uint8_t offset, const uint8_t value)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    transaction();
+    regs[offset] = value;
+}
+
+void SimulatedCpld::writeBlock(const uint8_t offset, const uint8_t length,
+                               const uint8_t* value)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    transaction();
+    for (size_t i = 0; i < length; i++)
+    {
+        regs[(offset + i) % regs.size()] = value[i];
+    }
+}
+
+} // namespace pfr
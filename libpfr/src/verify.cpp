@@ -0,0 +1,296 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "verify.hpp"
+
+#include "pfm.hpp"
+#include "spiDev.hpp"
+
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace pfr
+{
+
+// Enough for the signatures, the PFM and the capsule bitmaps.
+static constexpr size_t capsuleHeaderMaxLength = 128 * 1024;
+// Contiguous payload pages are read and hashed this much at a time.
+static constexpr size_t verifyChunkSize = 64 * 1024;
+
+using DigestCtx = std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)>;
+
+struct RegionJob
+{
+    size_t index;
+    uint32_t start;
+    uint32_t end;
+    ByteSpan sha256;
+    ByteSpan sha384;
+};
+
+// Capsule page layout, shared read only by the workers.
+struct PageMap
+{
+    SPIDev& dev;
+    size_t pageSize;
+    uint8_t pattern;
+    size_t payloadOffset;
+    size_t pageCount;
+    // Payload page index of every compressed page.
+    std::vector<uint32_t> payloadPage;
+    std::vector<bool> compressed;
+};
+
+static PageMap buildPageMap(const RecoveryCapsule& capsule, SPIDev& dev)
+{
+    const PbcHeader& pbc = capsule.pbc();
+    if (pbc.pageSize == 0)
+    {
+        throw std::runtime_error("Invalid capsule page size");
+    }
+
+    PageMap map{dev,
+                pbc.pageSize,
+                static_cast<uint8_t>(pbc.patternContent),
+                pbc.payloadOffset,
+                pbc.bitmapBits,
+                {},
+                {}};
+    map.payloadPage.resize(map.pageCount);
+    map.compressed.resize(map.pageCount);
+    uint32_t next = 0;
+    for (size_t page = 0; page < map.pageCount; page++)
+    {
+        // Page 0 is the most significant bit of the first byte.
+        map.compressed[page] =
+            pbc.compressionBitmap[page / 8] & (0x80 >> (page % 8));
+        map.payloadPage[page] = next;
+        if (map.compressed[page])
+        {
+            next++;
+        }
+    }
+    return map;
+}
+
+static void hashUpdate(const std::vector<DigestCtx>& ctxs, const uint8_t* data,
+                       const size_t length)
+{
+    for (const auto& ctx : ctxs)
+    {
+        if (EVP_DigestUpdate(ctx.get(), data, length) != 1)
+        {
+            throw std::runtime_error("Digest update failed");
+        }
+    }
+}
+
+// Feeds the region, as written to flash on recovery, to the digests.
+static void hashRegion(const PageMap& map, const RegionJob& job,
+                       const std::vector<DigestCtx>& ctxs,
+                       std::vector<uint8_t>& buffer,
+                       const std::function<void(size_t)>& done)
+{
+    size_t pos = job.start;
+    while (pos < job.end)
+    {
+        size_t page = pos / map.pageSize;
+        size_t pageOffset = pos % map.pageSize;
+        if (page >= map.pageCount)
+        {
+            throw std::runtime_error("Region outside of capsule bitmap");
+        }
+
+        // Extend over following pages of the same kind, which are also
+        // contiguous in the payload when compressed.
+        size_t length = std::min(map.pageSize - pageOffset, job.end - pos);
+        while (((length + map.pageSize) <= buffer.size()) &&
+               ((pos + length) < job.end) && ((page + 1) < map.pageCount) &&
+               (map.compressed[page + 1] == map.compressed[page]))
+        {
+            page++;
+            length += std::min(map.pageSize, job.end - (pos + length));
+        }
+
+        if (map.compressed[pos / map.pageSize])
+        {
+            size_t offset = map.payloadOffset +
+                            (map.payloadPage[pos / map.pageSize] *
+                             map.pageSize) +
+                            pageOffset;
+            map.dev.spiReadData(offset, length, buffer.data());
+        }
+        else
+        {
+            std::fill_n(buffer.begin(), length, map.pattern);
+        }
+
+        hashUpdate(ctxs, buffer.data(), length);
+        done(length);
+        pos += length;
+    }
+}
+
+static bool digestMatches(const DigestCtx& ctx, ByteSpan expected)
+{
+    std::array<uint8_t, EVP_MAX_MD_SIZE> digest;
+    unsigned int len = 0;
+    if (EVP_DigestFinal_ex(ctx.get(), digest.data(), &len) != 1)
+    {
+        throw std::runtime_error("Digest final failed");
+    }
+    return (len == expected.size()) &&
+           std::equal(expected.begin(), expected.end(), digest.begin());
+}
+
+static bool verifyRegion(const PageMap& map, const RegionJob& job,
+                         std::vector<uint8_t>& buffer,
+                         const std::function<void(size_t)>& done)
+{
+    std::vector<DigestCtx> ctxs;
+    std::vector<ByteSpan> expected;
+    for (const auto& [hash, md] : {std::make_pair(job.sha256, EVP_sha256()),
+                                   std::make_pair(job.sha384, EVP_sha384())})
+    {
+        if (hash.empty())
+        {
+            continue;
+        }
+        DigestCtx ctx(EVP_MD_CTX_new(), &EVP_MD_CTX_free);
+        if (!ctx || (EVP_DigestInit_ex(ctx.get(), md, nullptr) != 1))
+        {
+            throw std::runtime_error("Digest init failed");
+        }
+        ctxs.emplace_back(std::move(ctx));
+        expected.emplace_back(hash);
+    }
+
+    hashRegion(map, job, ctxs, buffer, done);
+
+    bool passed = true;
+    for (size_t i = 0; i < ctxs.size(); i++)
+    {
+        passed = digestMatches(ctxs[i], expected[i]) && passed;
+    }
+    return passed;
+}
+
+std::vector<RegionVerifyResult>
+    verifyRecoveryImage(const std::string& mtdDev, unsigned int threads,
+                        const VerifyProgressHandler& progress)
+{
+    MtdImage image(mtdDev, capsuleHeaderMaxLength);
+    RecoveryCapsule capsule(image.data());
+
+    std::vector<RegionJob> jobs;
+    std::vector<RegionVerifyResult> results;
+    PfmParser pfm = capsule.pfm();
+    while (auto definition = pfm.next())
+    {
+        const auto* region = std::get_if<PfmSpiRegion>(&*definition);
+        if ((region == nullptr) ||
+            (region->sha256.empty() && region->sha384.empty()))
+        {
+            continue;
+        }
+        if (region->endAddress < region->startAddress)
+        {
+            throw std::runtime_error("Invalid SPI region in PFM");
+        }
+        jobs.push_back(RegionJob{results.size(), region->startAddress,
+                                 region->endAddress, region->sha256,
+                                 region->sha384});
+        results.push_back(RegionVerifyResult{region->startAddress,
+                                             region->endAddress, false});
+    }
+
+    // Positioned reads, shared by all workers.
+    SPIDev spiDev(mtdDev);
+    const PageMap map = buildPageMap(capsule, spiDev);
+
+    // Largest regions first so the workers finish together.
+    std::sort(jobs.begin(), jobs.end(), [](const auto& a, const auto& b) {
+        return (a.end - a.start) > (b.end - b.start);
+    });
+    uint64_t total = 0;
+    for (const auto& job : jobs)
+    {
+        total += job.end - job.start;
+    }
+
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min<size_t>(threads, std::max<size_t>(1, jobs.size()));
+
+    std::atomic<size_t> nextJob = 0;
+    std::atomic<uint64_t> hashed = 0;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+        std::vector<uint8_t> buffer(std::max(verifyChunkSize, map.pageSize));
+        auto done = [&](const size_t bytes) {
+            uint64_t now = hashed.fetch_add(bytes) + bytes;
+            if (progress)
+            {
+                progress(now, total);
+            }
+        };
+        try
+        {
+            for (size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+            {
+                results[jobs[i].index].passed =
+                    verifyRegion(map, jobs[i], buffer, done);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            error = std::current_exception();
+            nextJob = jobs.size();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; i++)
+    {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    return results;
+}
+
+} // namespace pfr
@@ -0,0 +1,109 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "format.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+// Counts every heap allocation of the process.
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    allocations++;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+static int failures = 0;
+
+static void check(const bool ok, const char* what)
+{
+    if (!ok)
+    {
+        std::fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+int main()
+{
+    // Same digits as printf for every byte value.
+    for (unsigned int value = 0; value < 256; value++)
+    {
+        char expected[3];
+        std::snprintf(expected, sizeof(expected), "%02x", value);
+        pfr::FixedString<2> hex;
+        hex.appendHex(static_cast<uint8_t>(value));
+        check(hex.view() == expected, "appendHex");
+    }
+
+    check(pfr::FixedString<10>().appendDecimal(0).view() == "0",
+          "appendDecimal 0");
+    check(pfr::FixedString<10>().appendDecimal(4294967295u).view() ==
+              "4294967295",
+          "appendDecimal max");
+    check(pfr::FixedString<3>().append("truncated").view() == "tru",
+          "truncation");
+
+    // BMC versions from the PFM bytes, with printf as the reference.
+    static constexpr std::array<std::array<uint8_t, 6>, 3> pfms = {{
+        {0x00, 0x0B, 0x07, 0x1E, 0x5C, 0x2D},
+        {0x01, 0x00, 0x00, 0x00, 0x00, 0x00},
+        // Worst case, the longest version.
+        {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+    }};
+    size_t longest = 0;
+    for (const auto& pfm : pfms)
+    {
+        char expected[32];
+        std::snprintf(expected, sizeof(expected), "%u.%u-%u-g%02x%02x%02x",
+                      pfm[0], pfm[1], pfm[2], pfm[3], pfm[4], pfm[5]);
+
+        size_t before = allocations;
+        auto version = pfr::formatBMCVersion(pfm[0], pfm[1], pfm[2], &pfm[3]);
+        check(allocations == before, "BMC version formatting allocates");
+        check(version.view() == expected, "BMC version");
+        longest = std::max(longest, version.size());
+    }
+    check(longest == pfr::BMCVersionString::capacity(),
+          "BMC version capacity");
+
+    // CPLD held versions, <major>.<minor>.
+    size_t before = allocations;
+    check(pfr::formatVersion(255, 255).view() == "255.255", "version");
+    check(allocations == before, "version formatting allocates");
+
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
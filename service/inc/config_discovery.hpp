@@ -0,0 +1,93 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/container/flat_map.hpp>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/bus/match.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace pfr
+{
+
+/** @class ConfigDiscovery
+ *  @brief Finds the PFR configuration published by entity-manager. One
+ *         query covers anything published before start, InterfacesAdded
+ *         covers the rest. Every PFR record is reported, multi-node
+ *         platforms have one per node. A platform is decided to have no
+ *         PFR once its baseboard is published without a PFR record, other
+ *         boards do not count.
+ */
+class ConfigDiscovery
+{
+  public:
+    /** Called with the record path, mailbox bus and address every time a
+     *  configuration is published.
+     */
+    using ConfigHandler =
+        std::function<void(const std::string&, uint64_t, uint64_t)>;
+    /** Called once if the platform has no PFR configuration */
+    using AbsentHandler = std::function<void()>;
+
+    ConfigDiscovery(boost::asio::io_context& io,
+                    std::shared_ptr<sdbusplus::asio::connection> conn_,
+                    ConfigHandler onConfig_, AbsentHandler onAbsent_);
+
+    ConfigDiscovery(const ConfigDiscovery&) = delete;
+    ConfigDiscovery& operator=(const ConfigDiscovery&) = delete;
+
+    /** @brief Subscribes to InterfacesAdded and queries the mapper */
+    void start();
+
+    /** @brief The record is the baseboard CPLD, not one of another node */
+    static bool isBaseboardConfig(const std::string& path);
+
+  private:
+    using PropertyValue =
+        std::variant<std::string, uint64_t, int64_t, uint32_t, int32_t,
+                     uint16_t, uint8_t, bool, double, std::vector<std::string>,
+                     std::vector<uint64_t>>;
+    using PropertyMap = boost::container::flat_map<std::string, PropertyValue>;
+    using InterfaceMap = boost::container::flat_map<std::string, PropertyMap>;
+
+    void query();
+    void interfacesAdded(sdbusplus::message_t& msg);
+    void readConfig(const std::string& service, const std::string& path);
+    void applyConfig(const std::string& path, const PropertyMap& properties);
+    void baseboardFound();
+    void absent(const std::string& reason);
+
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+    ConfigHandler onConfig;
+    AbsentHandler onAbsent;
+    std::unique_ptr<sdbusplus::bus::match_t> addedMatch;
+    // Decides absence after the baseboard settles, or at the latest after
+    // the discovery timeout.
+    boost::asio::steady_timer timer;
+    bool found = false;
+    bool decided = false;
+};
+
+} // namespace pfr
@@ -0,0 +1,212 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+namespace pfr
+{
+
+/** Redfish message ID and reason of a CPLD event code */
+struct EventInfo
+{
+    std::string_view messageId;
+    std::string_view reason;
+
+    constexpr bool empty() const
+    {
+        return messageId.empty();
+    }
+};
+
+template <typename T>
+using CodeEntry = std::pair<uint8_t, T>;
+
+/** Indexed by code, empty entries are unknown codes */
+template <typename T>
+using Catalog = std::array<T, 256>;
+
+template <typename T, size_t N>
+constexpr bool uniqueCodes(const std::array<CodeEntry<T>, N>& entries)
+{
+    for (size_t i = 0; i < N; i++)
+    {
+        for (size_t j = i + 1; j < N; j++)
+        {
+            if (entries[i].first == entries[j].first)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/** @brief Builds the dense table of entries, on top of base if given */
+template <typename T, size_t N>
+constexpr Catalog<T> makeCatalog(const std::array<CodeEntry<T>, N>& entries,
+                                 Catalog<T> base = {})
+{
+    for (const auto& [code, value] : entries)
+    {
+        base[code] = value;
+    }
+    return base;
+}
+
+// Recovery reasons.
+// {<CPLD association>,{<Redfish MessageID>, <Recovery Reason>}}
+inline constexpr auto recoveryReasons = std::to_array<CodeEntry<EventInfo>>({
+    {0x01,
+     {"BIOSFirmwareRecoveryReason",
+      "BIOS active image authentication failure"}},
+    {0x02,
+     {"BIOSFirmwareRecoveryReason",
+      "BIOS recovery image authentication failure"}},
+    {0x03, {"MEFirmwareRecoveryReason", "ME launch failure"}},
+    {0x04, {"BIOSFirmwareRecoveryReason", "ACM launch failure"}},
+    {0x05, {"BIOSFirmwareRecoveryReason", "IBB launch failure"}},
+    {0x06, {"BIOSFirmwareRecoveryReason", "OBB launch failure"}},
+    {0x07,
+     {"BMCFirmwareRecoveryReason", "BMC active image authentication failure"}},
+    {0x08,
+     {"BMCFirmwareRecoveryReason",
+      "BMC recovery image authentication failure"}},
+    {0x09, {"BMCFirmwareRecoveryReason", "BMC launch failure"}},
+    {0x0A, {"CPLDFirmwareRecoveryReason", "CPLD watchdog expired"}},
+    {0x0B, {"BMCFirmwareRecoveryReason", "BMC attestation failure"}},
+    {0x0C, {"FirmwareResiliencyError", "CPU0  attestation failure"}},
+    {0x0D, {"FirmwareResiliencyError", "CPU1  attestation failure"}},
+});
+
+// Panic reasons.
+// {<CPLD association>, {<Redfish MessageID>, <Panic reason> })
+inline constexpr auto panicReasons = std::to_array<CodeEntry<EventInfo>>({
+    {0x01, {"BIOSFirmwarePanicReason", "BIOS update intent"}},
+    {0x02, {"BMCFirmwarePanicReason", "BMC update intent"}},
+    {0x03, {"BMCFirmwarePanicReason", "BMC reset detected"}},
+    {0x04, {"BMCFirmwarePanicReason", "BMC watchdog expired"}},
+    {0x05, {"MEFirmwarePanicReason", "ME watchdog expired"}},
+    {0x06, {"BIOSFirmwarePanicReason", "ACM/IBB/OBB WDT expired"}},
+    {0x09,
+     {"BIOSFirmwarePanicReason", "ACM or IBB or OBB authentication failure"}},
+    {0x0A, {"FirmwareResiliencyError", "Attestation failure"}},
+});
+
+// Firmware resiliency major error codes.
+// {<CPLD association>, {<Redfish MessageID>, <Error reason> })
+inline constexpr auto majorErrors = std::to_array<CodeEntry<EventInfo>>({
+    {0x01, {"BMCFirmwareResiliencyError", "BMC image authentication failed"}},
+    {0x02, {"BIOSFirmwareResiliencyError", "BIOS image authentication failed"}},
+    {0x03, {"BIOSFirmwareResiliencyError", "in-band and oob update failure"}},
+    {0x04, {"BMCFirmwareResiliencyError", "Communication setup failed"}},
+    {0x05,
+     {"FirmwareResiliencyError",
+      "Attestation measurement mismatch-Attestation failure"}},
+    {0x06, {"FirmwareResiliencyError", "Attestation challenge timeout"}},
+    {0x07, {"FirmwareResiliencyError", "SPDM protocol timeout"}},
+    {0x08, {"FirmwareResiliencyError", "I2c Communication failure"}},
+    {0x09,
+     {"CPLDFirmwareResiliencyError", "Combined CPLD authentication failure"}},
+    {0x0A, {"CPLDFirmwareResiliencyError", "Combined CPLD update failure"}},
+    {0x0B, {"CPLDFirmwareResiliencyError", "Combined CPLD recovery failure"}},
+    {0x10, {"FirmwareResiliencyError", "Image copy Failed"}},
+});
+
+// Major error codes redefined by RoT revision 2.
+inline constexpr auto majorErrorsRev2 = std::to_array<CodeEntry<EventInfo>>({
+    {0x03, {"FirmwareResiliencyError", "Firmware update failed"}},
+});
+
+// Postcode (platform state) names.
+inline constexpr auto postcodes = std::to_array<CodeEntry<std::string_view>>({
+    {0x00, "Postcode unavailable"},
+    {0x01, "CPLD Nios II processor waiting to start"},
+    {0x02, "CPLD Nios II processor started"},
+    {0x03, "Enter T-1"},
+    {0x04, "T-1 reserved 4"},
+    {0x05, "T-1 Reserved 5"},
+    {0x06, "BMC flash authentication"},
+    {0x07, "PCH/CPU flash authentication"},
+    {0x08, "Lockdown due to authentication failures"},
+    {0x09, "Enter T0"},
+    {0x0A, "T0 BMC booted"},
+    {0x0B, "T0 ME booted"},
+    {0x0C, "T0 Modular booted"},
+    {0x0D, "T0 BIOS booted"},
+    {0x0E, "T0 boot complete"},
+    {0x0F, "T0 Reserved 0xF"},
+    {0x10, "PCH/CPU firmware update"},
+    {0x11, "BMC firmware update"},
+    {0x12, "CPLD update (in CPLD Active Image)"},
+    {0x13, "CPLD update (in CPLD ROM)"},
+    {0x14, "PCH/CPU firmware volume update"},
+    {0x15, "CPLD Nios II processor waiting to start"},
+    {0x16, "Combined CPLD authentication"},
+    {0x17, "Combined CPLD booted from CFM0"},
+    {0x18, "Combined CPLD booted from Active CFM"},
+    {0x19, "Combined CPLD image update"},
+    {0x1A, "Combined CPLD image recovery"},
+    {0x1B, "Combined CPLD boot from CFM0 due to recovery failure"},
+    {0x40, "T-1 firmware recovery due to authentication failure"},
+    {0x41, "T-1 forced active firmware recovery"},
+    {0x42, "WDT timeout recovery"},
+    {0x43, "CPLD recovery (in CPLD ROM)"},
+    {0x44, "Lockdown due to PIT L1"},
+    {0x45, "PIT L2 firmware sealed"},
+    {0x46, "Lockdown due to PIT L2 PCH/CPU firmware hash mismatch"},
+    {0x47, "Lockdown due to PIT L2 BMC firmware hash mismatch"},
+    {0x48, "Reserved 0x48"},
+});
+
+static_assert(uniqueCodes(recoveryReasons), "Duplicate recovery reason");
+static_assert(uniqueCodes(panicReasons), "Duplicate panic reason");
+static_assert(uniqueCodes(majorErrors), "Duplicate major error code");
+static_assert(uniqueCodes(majorErrorsRev2), "Duplicate major error code");
+static_assert(uniqueCodes(postcodes), "Duplicate postcode");
+
+inline constexpr Catalog<EventInfo> recoveryReasonCatalog =
+    makeCatalog(recoveryReasons);
+inline constexpr Catalog<EventInfo> panicReasonCatalog =
+    makeCatalog(panicReasons);
+inline constexpr Catalog<EventInfo> majorErrorCatalog =
+    makeCatalog(majorErrors);
+inline constexpr Catalog<EventInfo> majorErrorCatalogRev2 =
+    makeCatalog(majorErrorsRev2, majorErrorCatalog);
+inline constexpr Catalog<std::string_view> postcodeCatalog =
+    makeCatalog(postcodes);
+
+/** @brief Name of a postcode, "Unknown" for undefined ones */
+constexpr std::string_view postcodeName(const uint8_t postcode)
+{
+    std::string_view name = postcodeCatalog[postcode];
+    return name.empty() ? "Unknown" : name;
+}
+
+static constexpr uint8_t rotRevision2 = 0x02;
+
+/** @brief Major error code catalog of a RoT revision */
+constexpr const Catalog<EventInfo>& majorErrorCatalogFor(const uint8_t rotRev)
+{
+    return (rotRev == rotRevision2) ? majorErrorCatalogRev2
+                                    : majorErrorCatalog;
+}
+
+} // namespace pfr
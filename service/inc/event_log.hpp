@@ -0,0 +1,39 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include "last_events.hpp"
+#include "pfr.hpp"
+
+#include <string_view>
+
+namespace pfr
+{
+
+/** @brief Logs a Redfish event for every counter or error code of the
+ *         snapshot that differs from the last ones
+ *
+ *  @param[in] last         - Counters and error codes already logged
+ *  @param[in] snapshot     - Mailbox status registers just read
+ *  @param[in] instance     - PFR instance name, empty for the baseboard
+ *  @return counters and error codes of the snapshot
+ */
+LastEvents logNewEvents(const LastEvents& last,
+                        const MailboxSnapshot& snapshot,
+                        std::string_view instance = {});
+
+} // namespace pfr
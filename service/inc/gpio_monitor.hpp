@@ -0,0 +1,60 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <boost/asio.hpp>
+#include <gpiod.hpp>
+
+#include <functional>
+#include <string>
+
+namespace pfr
+{
+
+/** @class GpioEventMonitor
+ *  @brief Calls a handler on the io_context for every edge of a GPIO line.
+ *         Stops waiting on an event wait error and calls onFailure, which
+ *         may destroy the monitor.
+ */
+class GpioEventMonitor
+{
+  public:
+    GpioEventMonitor(boost::asio::io_context& io, const std::string& name_,
+                     std::function<void()> handler_,
+                     std::function<void()> onFailure_);
+    ~GpioEventMonitor();
+
+    GpioEventMonitor(const GpioEventMonitor&) = delete;
+    GpioEventMonitor& operator=(const GpioEventMonitor&) = delete;
+
+    /** @brief Requests the line for edge events and starts waiting
+     *
+     *  @return false if the line could not be found or requested
+     */
+    bool start();
+
+  private:
+    void waitForEvent();
+
+    std::string name;
+    std::function<void()> handler;
+    std::function<void()> onFailure;
+    gpiod::line line;
+    boost::asio::posix::stream_descriptor eventDesc;
+};
+
+} // namespace pfr
@@ -0,0 +1,123 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <boost/asio/steady_timer.hpp>
+#include <sdbusplus/asio/connection.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace pfr
+{
+
+/** Last event counters and error codes seen on the CPLD */
+struct LastEvents
+{
+    uint8_t recoveryCount = 0;
+    uint8_t panicCount = 0;
+    uint8_t majorErr = 0;
+    uint8_t minorErr = 0;
+
+    bool operator==(const LastEvents&) const = default;
+};
+
+/** @class LastEventsShadow
+ *  @brief Authoritative copy of the last events, mirrored to a mapped
+ *         state file so that it survives service restarts. Without a
+ *         usable state file it lives in memory only.
+ */
+class LastEventsShadow
+{
+  public:
+    explicit LastEventsShadow(const std::string& path);
+    ~LastEventsShadow();
+
+    LastEventsShadow(const LastEventsShadow&) = delete;
+    LastEventsShadow& operator=(const LastEventsShadow&) = delete;
+
+    /** @brief Counters are known, from the state file or set since */
+    bool loaded() const
+    {
+        return valid;
+    }
+
+    const LastEvents& get() const
+    {
+        return events;
+    }
+
+    /** @brief Updates the shadow and the state file */
+    void set(const LastEvents& events_);
+
+  private:
+    struct StateRecord
+    {
+        uint32_t magic;
+        LastEvents events;
+        // Inverse of the packed events, a torn write does not match.
+        uint32_t check;
+    };
+
+    static uint32_t checkOf(const LastEvents& events);
+
+    StateRecord* record = nullptr;
+    LastEvents events;
+    bool valid = false;
+};
+
+/** @class LastEventsWriter
+ *  @brief Write-behind of the last event counters kept in Settings. Changes
+ *         queued during a poll go out together on flush, one batch at a
+ *         time. A failed batch is retried with back-off, merged with
+ *         anything queued meanwhile.
+ */
+class LastEventsWriter
+{
+  public:
+    LastEventsWriter(boost::asio::io_context& io,
+                     std::shared_ptr<sdbusplus::asio::connection> conn_);
+
+    LastEventsWriter(const LastEventsWriter&) = delete;
+    LastEventsWriter& operator=(const LastEventsWriter&) = delete;
+
+    /** @brief Queues a counter value, replacing any unwritten one */
+    void set(const std::string& name, const uint8_t value);
+
+    /** @brief Writes the queued values, unless a batch is in flight or
+     *         waiting to be retried. Those pick up the queue when done.
+     */
+    void flush();
+
+  private:
+    void write();
+    void batchDone();
+
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+    boost::asio::steady_timer retryTimer;
+    std::map<std::string, uint8_t> queued;
+    std::map<std::string, uint8_t> inFlight;
+    size_t outstanding = 0;
+    bool batchFailed = false;
+    bool retryPending = false;
+    std::chrono::seconds retryDelay;
+};
+
+} // namespace pfr
@@ -0,0 +1,131 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include "ioExecutor.hpp"
+#include "last_events.hpp"
+#include "pfr.hpp"
+#include "poll_scheduler.hpp"
+#include "property_binder.hpp"
+#include "transport.hpp"
+
+#include <boost/asio/steady_timer.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace pfr
+{
+
+/** @class PfrInstance
+ *  @brief PFR CPLD of another node of a multi-node platform, the baseboard
+ *         CPLD is served by the objects under /xyz/openbmc_project/pfr.
+ *         Each instance has its own mailbox transport, poller and last
+ *         events, and publishes its status, versions and last events under
+ *         /xyz/openbmc_project/pfr/<name>.
+ */
+class PfrInstance
+{
+  public:
+    PfrInstance(sdbusplus::asio::object_server& srv_,
+                std::shared_ptr<sdbusplus::asio::connection>& conn_,
+                IoExecutor& executor_, const std::string& name_,
+                const uint64_t i2cBus, const uint64_t address);
+    ~PfrInstance();
+
+    PfrInstance(const PfrInstance&) = delete;
+    PfrInstance& operator=(const PfrInstance&) = delete;
+
+    /** @brief Instance name of an entity-manager PFR record, the name of
+     *         the board holding it
+     *
+     *  @param[in] configPath   - PFR record object path
+     */
+    static std::string nameOf(const std::string& configPath);
+
+    /** @brief Updates the mailbox location on a configuration reload
+     *
+     *  @param[in] i2cBus       - I2C bus number
+     *  @param[in] address      - I2C slave address
+     *  @param[in] queue        - Transaction queue of the bus
+     */
+    void setAddress(const uint64_t i2cBus, const uint64_t address,
+                    IoExecutor& queue);
+
+    /** @brief Rereads the provisioning status and versions, done is called
+     *         once they are published
+     */
+    void refresh(std::function<void()> done = nullptr);
+
+    const std::string& getName() const
+    {
+        return name;
+    }
+
+  private:
+    struct VersionObject
+    {
+        ImageType imgType;
+        std::shared_ptr<sdbusplus::asio::dbus_interface> iface;
+        std::optional<PropertyBatch> batch;
+        std::optional<BoundProperty<std::string>> version;
+    };
+
+    void schedulePoll();
+    void poll();
+    void handleSnapshot(const MailboxSnapshot& snapshot);
+
+    sdbusplus::asio::object_server& server;
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+    // Transaction queue of the mailbox bus.
+    IoExecutor* executor;
+    std::string name;
+    std::string objPath;
+    // Shared with the jobs on the I/O thread.
+    std::shared_ptr<MailboxTransport> transport;
+    PollScheduler scheduler;
+    boost::asio::steady_timer pollTimer;
+    LastEventsShadow lastEvents;
+    std::optional<uint8_t> lastState;
+
+    std::shared_ptr<sdbusplus::asio::dbus_interface> attrIface;
+    std::optional<PropertyBatch> attrBatch;
+    std::optional<BoundProperty<bool>> ufmProvisioned;
+    std::optional<BoundProperty<bool>> ufmLocked;
+    std::optional<BoundProperty<bool>> ufmSupport;
+
+    std::shared_ptr<sdbusplus::asio::dbus_interface> postcodeIface;
+    std::optional<PropertyBatch> postcodeBatch;
+    std::optional<BoundProperty<uint8_t>> postcodeData;
+    std::optional<BoundProperty<std::string>> postcodeStr;
+
+    std::shared_ptr<sdbusplus::asio::dbus_interface> lastEventsIface;
+    std::optional<PropertyBatch> lastEventsBatch;
+    std::optional<BoundProperty<uint8_t>> lastRecoveryCount;
+    std::optional<BoundProperty<uint8_t>> lastPanicCount;
+    std::optional<BoundProperty<uint8_t>> lastMajorErr;
+    std::optional<BoundProperty<uint8_t>> lastMinorErr;
+
+    std::vector<std::unique_ptr<VersionObject>> versions;
+};
+
+} // namespace pfr
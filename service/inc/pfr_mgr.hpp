@@ -16,15 +16,29 @@
 
 #pragma once
 
+#include "event_catalog.hpp"
+#include "ioExecutor.hpp"
+#include "metrics.hpp"
+#include "pfm.hpp"
 #include "pfr.hpp"
+#include "phase_log.hpp"
+#include "property_binder.hpp"
+#include "state_history.hpp"
+#include "verify.hpp"
 
 #include <boost/asio.hpp>
-#include <boost/container/flat_map.hpp>
 #include <phosphor-logging/lg2.hpp>
 #include <phosphor-logging/log.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace pfr
 {
@@ -46,18 +60,28 @@ class PfrVersion
   public:
     PfrVersion(sdbusplus::asio::object_server& srv_,
                std::shared_ptr<sdbusplus::asio::connection>& conn_,
-               const std::string& path_, const ImageType& imgType_,
-               const std::string& purpose_);
+               IoExecutor& executor_, const std::string& path_,
+               const ImageType& imgType_, const std::string& purpose_,
+               const std::string& version_);
     ~PfrVersion() = default;
 
     std::shared_ptr<sdbusplus::asio::connection> conn;
 
-    void updateVersion();
+    /** @brief Rereads the version, done is called once it is published */
+    void updateVersion(std::function<void()> done = nullptr);
+
+    /** @brief Object name under /xyz/openbmc_project/software */
+    const std::string& getName() const
+    {
+        return path;
+    }
 
   private:
     sdbusplus::asio::object_server& server;
+    IoExecutor& executor;
     std::shared_ptr<sdbusplus::asio::dbus_interface> versionIface;
-    bool internalSet = false;
+    std::optional<PropertyBatch> versionBatch;
+    std::optional<BoundProperty<std::string>> versionProp;
 
     std::string path;
     std::string version;
@@ -69,93 +93,175 @@ class PfrConfig
 {
   public:
     PfrConfig(sdbusplus::asio::object_server& srv_,
-              std::shared_ptr<sdbusplus::asio::connection>& conn_);
+              std::shared_ptr<sdbusplus::asio::connection>& conn_,
+              IoExecutor& executor_, const MailboxRegisters& regs);
     ~PfrConfig() = default;
 
     std::shared_ptr<sdbusplus::asio::connection> conn;
 
-    void updateProvisioningStatus();
+    /** @brief Rereads the status, done is called once it is published */
+    void updateProvisioningStatus(std::function<void()> done = nullptr);
 
     bool getPfrProvisioned() const
     {
-        return ufmProvisioned;
+        return ufmProvisioned && ufmProvisioned->get();
     }
 
   private:
     sdbusplus::asio::object_server& server;
+    IoExecutor& executor;
     std::shared_ptr<sdbusplus::asio::dbus_interface> pfrCfgIface;
     std::shared_ptr<sdbusplus::asio::dbus_interface> pfrMBIface;
 
-    bool internalSet = false;
-
-    bool ufmProvisioned;
-    bool ufmLocked;
-    bool ufmSupport;
+    std::optional<PropertyBatch> cfgBatch;
+    std::optional<BoundProperty<bool>> ufmProvisioned;
+    std::optional<BoundProperty<bool>> ufmLocked;
+    std::optional<BoundProperty<bool>> ufmSupport;
 };
 
-// Firmware resiliency major map.
-// {<CPLD association>, {<Redfish MessageID>, <Error reason> })
-static const boost::container::flat_map<uint8_t,
-                                        std::pair<std::string, std::string>>
-    majorErrorCodeMapRev2 = {
-        {0x03, {"FirmwareResiliencyError", "Firmware update failed"}}};
-
-// postcode (platform state) map.
-static const boost::container::flat_map<uint8_t, std::string> postcodeMap = {
-    {0x00, "Postcode unavailable"},
-    {0x01, "CPLD Nios II processor waiting to start"},
-    {0x02, "CPLD Nios II processor started"},
-    {0x03, "Enter T-1"},
-    {0x04, "T-1 reserved 4"},
-    {0x05, "T-1 Reserved 5"},
-    {0x06, "BMC flash authentication"},
-    {0x07, "PCH/CPU flash authentication"},
-    {0x08, "Lockdown due to authentication failures"},
-    {0x09, "Enter T0"},
-    {0x0A, "T0 BMC booted"},
-    {0x0B, "T0 ME booted"},
-    {0x0C, "T0 Modular booted"},
-    {0x0C, "T0 BIOS booted"},
-    {0x0E, "T0 boot complete"},
-    {0x0F, "T0 Reserved 0xF"},
-    {0x10, "PCH/CPU firmware update"},
-    {0x11, "BMC firmware update"},
-    {0x12, "CPLD update (in CPLD Active Image)"},
-    {0x13, "CPLD update (in CPLD ROM)"},
-    {0x14, "PCH/CPU firmware volume update"},
-    {0x15, "CPLD Nios II processor waiting to start"},
-    {0x16, "Combined CPLD authentication"},
-    {0x17, "Combined CPLD booted from CFM0"},
-    {0x18, "Combined CPLD booted from Active CFM"},
-    {0x19, "Combined CPLD image update"},
-    {0x1A, "Combined CPLD image recovery"},
-    {0x1B, "Combined CPLD boot from CFM0 due to recovery failure"},
-    {0x40, "T-1 firmware recovery due to authentication failure"},
-    {0x41, "T-1 forced active firmware recovery"},
-    {0x42, "WDT timeout recovery"},
-    {0x43, "CPLD recovery (in CPLD ROM)"},
-    {0x44, "Lockdown due to PIT L1"},
-    {0x45, "PIT L2 firmware sealed"},
-    {0x46, "Lockdown due to PIT L2 PCH/CPU firmware hash mismatch"},
-    {0x47, "Lockdown due to PIT L2 BMC firmware hash mismatch"},
-    {0x48, "Reserved 0x48"}};
-
 class PfrPostcode
 {
   public:
     PfrPostcode(sdbusplus::asio::object_server& srv_,
-                std::shared_ptr<sdbusplus::asio::connection>& conn_);
+                std::shared_ptr<sdbusplus::asio::connection>& conn_,
+                IoExecutor& executor_, const MailboxRegisters& regs);
     ~PfrPostcode() = default;
 
     std::shared_ptr<sdbusplus::asio::connection> conn;
 
     void updatePostcode();
 
+    /** @brief Publishes a platform state read elsewhere, e.g. by an event
+     *         poll, and adds it to the history
+     */
+    void recordPlatformState(const uint8_t state);
+
+    /** @brief Profiles the next boot up to T0 boot complete. The timeline
+     *         is written to /run and published on D-Bus.
+     */
+    void startBootProfile();
+
   private:
+    void setPostcode(const uint8_t value);
+
+    /** @brief Builds the timeline from the sampled transitions
+     *
+     *  @param[in] startUs          - Profile start timestamp
+     */
+    void saveBootTimeline(const uint64_t startUs);
+
     sdbusplus::asio::object_server& server;
+    IoExecutor& executor;
+    PlatformStateSampler sampler;
     std::shared_ptr<sdbusplus::asio::dbus_interface> pfrPostcodeIface;
-    bool internalSet = false;
-    uint8_t postcode;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> pfrBootTimelineIface;
+    std::optional<PropertyBatch> postcodeBatch;
+    std::optional<BoundProperty<uint8_t>> postcodeData;
+    std::optional<BoundProperty<std::string>> postcodeStr;
+    bool readPending = false;
+    bool lastReadValid = false;
+    std::chrono::steady_clock::time_point lastRead;
+};
+
+struct PfmTable;
+
+/** @class PfrPfm
+ *  @brief Publishes the decoded PFM of a BMC image, and the capsule layout
+ *         for the recovery image, under /xyz/openbmc_project/pfr/pfm.
+ */
+class PfrPfm
+{
+  public:
+    PfrPfm(sdbusplus::asio::object_server& srv_,
+           std::shared_ptr<sdbusplus::asio::connection>& conn_,
+           IoExecutor& executor_, const std::string& name_,
+           const ImageType& imgType_);
+    ~PfrPfm() = default;
+
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+
+    /** @brief Decodes the image again on the I/O thread and republishes */
+    void update();
+
+  private:
+    void publish(const PfmTable& table);
+
+    sdbusplus::asio::object_server& server;
+    IoExecutor& executor;
+    std::string objPath;
+    ImageType imgType;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> pfmIface;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> capsuleIface;
+    std::vector<std::shared_ptr<sdbusplus::asio::dbus_interface>> entryIfaces;
+};
+
+/** @class PfrRecoveryVerify
+ *  @brief Verifies the BMC recovery image against the hashes in its PFM
+ *         on request, before the CPLD has to recover from it.
+ */
+class PfrRecoveryVerify
+{
+  public:
+    PfrRecoveryVerify(sdbusplus::asio::object_server& srv_,
+                      std::shared_ptr<sdbusplus::asio::connection>& conn_);
+    ~PfrRecoveryVerify();
+
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+
+  private:
+    /** @brief Publishes progress, called from the hashing threads */
+    void reportProgress(const uint64_t done, const uint64_t total);
+
+    sdbusplus::asio::object_server& server;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> verifyIface;
+    std::thread worker;
+    bool verifying = false;
+    /** @brief Last percentage posted by the hashing threads */
+    std::atomic<uint8_t> postedProgress = 0;
+    uint8_t progress = 0;
+};
+
+/** @class PfrMetrics
+ *  @brief Publishes the mailbox register and mtd device transaction
+ *         metrics. Values are read from the counters on every Get.
+ */
+class PfrMetrics
+{
+  public:
+    PfrMetrics(sdbusplus::asio::object_server& srv_,
+               std::shared_ptr<sdbusplus::asio::connection>& conn_);
+    ~PfrMetrics() = default;
+
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+
+  private:
+    sdbusplus::asio::object_server& server;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> metricsIface;
+};
+
+/** @class PfrTiming
+ *  @brief Publishes the startup phases and the last cache refresh phases
+ */
+class PfrTiming
+{
+  public:
+    PfrTiming(sdbusplus::asio::object_server& srv_,
+              std::shared_ptr<sdbusplus::asio::connection>& conn_);
+    ~PfrTiming() = default;
+
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+
+    void setStartupPhases(const PhaseLog& log);
+    void setRefreshPhases(const PhaseLog& log);
+
+  private:
+    sdbusplus::asio::object_server& server;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> timingIface;
+    std::optional<PropertyBatch> timingBatch;
+    std::optional<BoundProperty<std::vector<PhaseLog::Phase>>> startupPhases;
+    std::optional<BoundProperty<std::vector<PhaseLog::Phase>>> refreshPhases;
+    std::optional<BoundProperty<uint64_t>> refreshCount;
+    std::optional<BoundProperty<uint64_t>> refreshMaxUsec;
 };
 
 } // namespace pfr
@@ -0,0 +1,101 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace pfr
+{
+
+/** @class PhaseLog
+ *  @brief Named phases of a run in the order they ended. End times are
+ *         CLOCK_MONOTONIC, the same clock as the journal monotonic
+ *         timestamps.
+ */
+class PhaseLog
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+    /** <name, end time in usec, duration in usec> */
+    using Phase = std::tuple<std::string, uint64_t, uint64_t>;
+
+    /** @brief Creates an empty log
+     *
+     *  @param[in] origin_      - Start of the run, summary offsets are
+     *                            relative to it
+     */
+    explicit PhaseLog(const Clock::time_point& origin_ = Clock::now()) :
+        origin(origin_)
+    {}
+
+    void record(const std::string& name, const Clock::time_point& begin,
+                const Clock::time_point& end = Clock::now())
+    {
+        entries.emplace_back(name, toUsec(end.time_since_epoch()),
+                             toUsec(end - begin));
+    }
+
+    const std::vector<Phase>& phases() const
+    {
+        return entries;
+    }
+
+    /** @brief Time from the origin to the end of the last phase, in usec */
+    uint64_t elapsed() const
+    {
+        if (entries.empty())
+        {
+            return 0;
+        }
+        return std::get<1>(entries.back()) -
+               toUsec(origin.time_since_epoch());
+    }
+
+    /** @brief One line, e.g. "Snapshot 35 ms (at 36 ms), ..." */
+    std::string summary() const
+    {
+        std::string line;
+        uint64_t start = toUsec(origin.time_since_epoch());
+        for (const auto& [name, end, duration] : entries)
+        {
+            if (!line.empty())
+            {
+                line += ", ";
+            }
+            line += name + " " + std::to_string(duration / 1000) + " ms (at " +
+                    std::to_string((end - start) / 1000) + " ms)";
+        }
+        return line;
+    }
+
+  private:
+    template <typename Duration>
+    static uint64_t toUsec(const Duration& duration)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+            .count();
+    }
+
+    Clock::time_point origin;
+    std::vector<Phase> entries;
+};
+
+} // namespace pfr
@@ -0,0 +1,128 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace pfr
+{
+
+/** @class PollScheduler
+ *  @brief Picks the mailbox poll interval from the platform state. Polls
+ *         at the minimum interval while the postcode is changing or in a
+ *         T-1, update or recovery state, backs off exponentially while
+ *         stable in T0 and drops to the idle interval once the host has
+ *         booted. Every interval respects the per-minute bus budget.
+ */
+class PollScheduler
+{
+  public:
+    using Interval = std::chrono::milliseconds;
+
+    /** @brief Creates the scheduler
+     *
+     *  @param[in] minInterval_     - Interval while the state is changing
+     *  @param[in] maxInterval_     - Back-off limit while stable in T0
+     *  @param[in] idleInterval_    - Audit interval after host boot
+     *  @param[in] busBudget_       - Max mailbox polls per minute
+     */
+    PollScheduler(const Interval& minInterval_, const Interval& maxInterval_,
+                  const Interval& idleInterval_,
+                  const unsigned int busBudget_) :
+        minInterval(minInterval_), maxInterval(maxInterval_),
+        idleInterval(idleInterval_), busBudget(busBudget_),
+        interval(minInterval_)
+    {}
+
+    /** @brief Poll fast again, e.g. on power on or host start */
+    void setActive()
+    {
+        idle = false;
+        interval = minInterval;
+    }
+
+    /** @brief Host booted or powered off, keep a low rate audit */
+    void setIdle()
+    {
+        idle = true;
+    }
+
+    /** @brief Updates the interval from a polled platform state
+     *
+     *  @param[in] state            - Platform state (postcode) register
+     */
+    void observe(const uint8_t state)
+    {
+        bool changed = !stateValid || (state != lastState);
+        lastState = state;
+        stateValid = true;
+
+        if (changed || isTransient(state))
+        {
+            interval = minInterval;
+        }
+        else
+        {
+            interval = std::min(interval * 2, maxInterval);
+        }
+    }
+
+    /** @brief Interval until the next poll */
+    Interval next() const
+    {
+        Interval next = interval;
+        if (idle && (interval >= maxInterval))
+        {
+            next = idleInterval;
+        }
+        if (busBudget)
+        {
+            Interval budgetFloor = std::chrono::minutes(1) / busBudget;
+            next = std::max(next, budgetFloor);
+        }
+        return next;
+    }
+
+    /** @brief T-1 boot, firmware update and recovery states */
+    static bool isTransient(const uint8_t state)
+    {
+        return (state < t0Start) || ((state >= updateStart) &&
+                                     (state <= updateEnd)) ||
+               ((state >= recoveryStart) && (state <= recoveryEnd));
+    }
+
+  private:
+    static constexpr uint8_t t0Start = 0x09;
+    static constexpr uint8_t updateStart = 0x10;
+    static constexpr uint8_t updateEnd = 0x1A;
+    static constexpr uint8_t recoveryStart = 0x40;
+    static constexpr uint8_t recoveryEnd = 0x47;
+
+    Interval minInterval;
+    Interval maxInterval;
+    Interval idleInterval;
+    unsigned int busBudget;
+
+    Interval interval;
+    bool idle = false;
+    bool stateValid = false;
+    uint8_t lastState = 0;
+};
+
+} // namespace pfr
@@ -0,0 +1,173 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include <systemd/sd-bus.h>
+
+#include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pfr
+{
+
+/** @class PropertyBatch
+ *  @brief Collects the properties of one interface changed during a
+ *         refresh and signals them in a single PropertiesChanged.
+ */
+class PropertyBatch
+{
+  public:
+    PropertyBatch(std::shared_ptr<sdbusplus::asio::connection> conn_,
+                  std::shared_ptr<sdbusplus::asio::dbus_interface> iface_) :
+        conn(std::move(conn_)), iface(std::move(iface_))
+    {}
+
+    PropertyBatch(const PropertyBatch&) = delete;
+    PropertyBatch& operator=(const PropertyBatch&) = delete;
+
+    sdbusplus::asio::dbus_interface& interface()
+    {
+        return *iface;
+    }
+
+    /** @brief Bumped on every flush. A property is queued once per
+     *         generation.
+     */
+    uint64_t generation() const
+    {
+        return gen;
+    }
+
+    void queue(const std::string& name)
+    {
+        changed.push_back(name);
+    }
+
+    /** @brief Signals everything queued since the last flush */
+    void flush()
+    {
+        if (changed.empty())
+        {
+            return;
+        }
+
+        if (iface->is_initialized())
+        {
+            std::vector<char*> names;
+            for (auto& name : changed)
+            {
+                names.push_back(name.data());
+            }
+            names.push_back(nullptr);
+
+            // Values are fetched through the property getters.
+            int ret = sd_bus_emit_properties_changed_strv(
+                conn->get(), iface->get_object_path().c_str(),
+                iface->get_interface_name().c_str(), names.data());
+            if (ret < 0)
+            {
+                lg2::error("Failed to emit PropertiesChanged: {MSG}", "MSG",
+                           std::strerror(-ret));
+            }
+        }
+        changed.clear();
+        gen++;
+    }
+
+  private:
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> iface;
+    std::vector<std::string> changed;
+    uint64_t gen = 0;
+};
+
+/** @class BoundProperty
+ *  @brief Read only D-Bus property served from a shadow value. Updates
+ *         that do not change the value are dropped, changes are signalled
+ *         by the next flush of the batch.
+ */
+template <typename T>
+class BoundProperty
+{
+  public:
+    /** @brief Registers the property on the batch interface
+     *
+     *  @param[in] batch_       - Batch of the interface
+     *  @param[in] name_        - Property name
+     *  @param[in] initial      - Initial value
+     *  @param[in] onGet        - Optional, called before every Get
+     */
+    BoundProperty(PropertyBatch& batch_, const std::string& name_,
+                  const T& initial, std::function<void()> onGet = nullptr) :
+        batch(batch_), name(name_), shadow(initial)
+    {
+        batch.interface().register_property_r(
+            name, shadow, sdbusplus::vtable::property_::emits_change,
+            [this, onGet = std::move(onGet)](const T&) {
+                if (onGet)
+                {
+                    onGet();
+                }
+                return shadow;
+            });
+    }
+
+    BoundProperty(const BoundProperty&) = delete;
+    BoundProperty& operator=(const BoundProperty&) = delete;
+
+    /** @brief Updates the shadow value
+     *
+     *  @return true if the value changed
+     */
+    bool set(const T& value)
+    {
+        if (value == shadow)
+        {
+            return false;
+        }
+        shadow = value;
+        if (!queued || (queuedGeneration != batch.generation()))
+        {
+            batch.queue(name);
+            queued = true;
+            queuedGeneration = batch.generation();
+        }
+        return true;
+    }
+
+    const T& get() const
+    {
+        return shadow;
+    }
+
+  private:
+    PropertyBatch& batch;
+    std::string name;
+    T shadow;
+    bool queued = false;
+    uint64_t queuedGeneration = 0;
+};
+
+} // namespace pfr
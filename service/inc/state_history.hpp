@@ -0,0 +1,165 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#pragma once
+
+#include "ioExecutor.hpp"
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <tuple>
+#include <vector>
+
+namespace pfr
+{
+
+/** @class StateHistory
+ *  @brief Fixed size ring of platform state transitions. One writer
+ *         never allocates or waits, readers copy it out lock free.
+ */
+template <size_t size>
+class StateHistory
+{
+  public:
+    /** <monotonic timestamp in microseconds, platform state> */
+    using Entry = std::tuple<uint64_t, uint8_t>;
+
+    /** @brief Appends a transition. Single writer only. */
+    void push(const uint64_t timestampUs, const uint8_t state)
+    {
+        uint64_t index = head.load(std::memory_order_relaxed);
+        Slot& slot = slots[index % size];
+
+        // Odd sequence marks the slot as being written.
+        slot.seq.store((index * 2) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.value.store((timestampUs << 8) | state,
+                         std::memory_order_relaxed);
+        slot.seq.store((index * 2) + 2, std::memory_order_release);
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    /** @brief Copies the transitions out, oldest first. Entries being
+     *         overwritten while copying are skipped.
+     */
+    std::vector<Entry> read() const
+    {
+        std::vector<Entry> entries;
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t begin = (end > size) ? (end - size) : 0;
+        entries.reserve(end - begin);
+
+        for (uint64_t index = begin; index < end; index++)
+        {
+            const Slot& slot = slots[index % size];
+            uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            uint64_t value = slot.value.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((seq != ((index * 2) + 2)) ||
+                (slot.seq.load(std::memory_order_relaxed) != seq))
+            {
+                continue;
+            }
+            entries.emplace_back(value >> 8, static_cast<uint8_t>(value));
+        }
+        return entries;
+    }
+
+  private:
+    struct Slot
+    {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<uint64_t> value{0};
+    };
+
+    std::array<Slot, size> slots;
+    std::atomic<uint64_t> head{0};
+};
+
+/** @class PlatformStateSampler
+ *  @brief Reads the platform state on a fixed period, as polling
+ *         transactions of the I/O executor, and records every transition.
+ *         States read by the event polls and postcode Gets are recorded
+ *         too. D-Bus thread only.
+ */
+class PlatformStateSampler
+{
+  public:
+    static constexpr size_t historySize = 128;
+    using History = StateHistory<historySize>;
+
+    /** @brief Constructor
+     *
+     *  @param[in] io               - io_context of the D-Bus connection
+     *  @param[in] executor_        - Executor of the state reads
+     *  @param[in] interval_        - Sample period
+     */
+    PlatformStateSampler(boost::asio::io_context& io, IoExecutor& executor_,
+                         const std::chrono::milliseconds& interval_);
+
+    PlatformStateSampler(const PlatformStateSampler&) = delete;
+    PlatformStateSampler& operator=(const PlatformStateSampler&) = delete;
+
+    const History& history() const
+    {
+        return transitions;
+    }
+
+    /** @brief Records a platform state read from the mailbox */
+    void record(const uint8_t state);
+
+    /** Called with the profile start timestamp */
+    using ProfileHandler = std::function<void(uint64_t)>;
+
+    /** @brief Samples every 10 ms until the platform leaves and returns
+     *         to T0 boot complete, then calls handler. Abandoned if the
+     *         platform never leaves T0 boot complete.
+     *
+     *  @param[in] handler          - Profile completion handler
+     */
+    void startProfile(ProfileHandler handler);
+
+  private:
+    /** @brief Reads the state after delay, unless a read is pending */
+    void sample(const std::chrono::milliseconds& delay);
+
+    /** @brief Ends the profile on boot complete or timeout */
+    void checkProfile(const uint8_t state);
+
+    IoExecutor& executor;
+    boost::asio::steady_timer timer;
+    std::chrono::milliseconds interval;
+    History transitions;
+    bool stateValid = false;
+    uint8_t lastState = 0;
+
+    bool readPending = false;
+    bool failureLogged = false;
+    /** @brief Delay after a failed read, zero while reads succeed */
+    std::chrono::milliseconds backoff{0};
+
+    bool profiling = false;
+    bool profileBootSeen = false;
+    std::chrono::steady_clock::time_point profileStart;
+    ProfileHandler profileHandler;
+};
+
+} // namespace pfr
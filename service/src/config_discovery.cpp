@@ -0,0 +1,229 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "config_discovery.hpp"
+
+#include <boost/algorithm/string.hpp>
+#include <phosphor-logging/log.hpp>
+
+#include <array>
+
+namespace pfr
+{
+
+static constexpr const char* inventoryPath =
+    "/xyz/openbmc_project/inventory/system";
+static constexpr const char* pfrConfigIface =
+    "xyz.openbmc_project.Configuration.PFR";
+static constexpr const char* boardIface =
+    "xyz.openbmc_project.Inventory.Item.Board";
+static constexpr const char* baseboardSuffix = "Baseboard";
+static constexpr const char* pfrConfigSuffix = "Baseboard/PFR";
+
+// entity-manager publishes every record of a board in one pass, a
+// baseboard without a PFR record by then has none.
+static constexpr std::chrono::seconds baseboardSettle(2);
+// No baseboard at all, e.g. entity-manager not running. Same as the worst
+// case of the former mapper polling.
+static constexpr std::chrono::seconds discoveryTimeout(100);
+
+using GetSubTreeType = std::vector<
+    std::pair<std::string,
+              std::vector<std::pair<std::string, std::vector<std::string>>>>>;
+
+ConfigDiscovery::ConfigDiscovery(
+    boost::asio::io_context& io,
+    std::shared_ptr<sdbusplus::asio::connection> conn_,
+    ConfigHandler onConfig_, AbsentHandler onAbsent_) :
+    conn(std::move(conn_)), onConfig(std::move(onConfig_)),
+    onAbsent(std::move(onAbsent_)), timer(io)
+{}
+
+void ConfigDiscovery::start()
+{
+    // Subscribe before the query, nothing published in between is lost.
+    addedMatch = std::make_unique<sdbusplus::bus::match_t>(
+        static_cast<sdbusplus::bus_t&>(*conn),
+        sdbusplus::bus::match::rules::interfacesAdded(
+            std::string(inventoryPath) + "/"),
+        [this](sdbusplus::message_t& msg) { interfacesAdded(msg); });
+
+    timer.expires_after(discoveryTimeout);
+    timer.async_wait([this](const boost::system::error_code& ec) {
+        if (!ec && !found)
+        {
+            absent("No PFR configuration published");
+        }
+    });
+
+    query();
+}
+
+void ConfigDiscovery::query()
+{
+    conn->async_method_call(
+        [this](const boost::system::error_code ec,
+               const GetSubTreeType& resp) {
+            if (ec)
+            {
+                // Mapper not up yet, InterfacesAdded still applies.
+                phosphor::logging::log<phosphor::logging::level::INFO>(
+                    "Unable to query the PFR configuration",
+                    phosphor::logging::entry("MSG=%s", ec.message().c_str()));
+                return;
+            }
+            for (const auto& [path, services] : resp)
+            {
+                for (const auto& [service, interfaces] : services)
+                {
+                    for (const auto& iface : interfaces)
+                    {
+                        if (iface == pfrConfigIface)
+                        {
+                            found = found || isBaseboardConfig(path);
+                            readConfig(service, path);
+                        }
+                        else if ((iface == boardIface) &&
+                                 boost::ends_with(path, baseboardSuffix))
+                        {
+                            baseboardFound();
+                        }
+                    }
+                }
+            }
+        },
+        "xyz.openbmc_project.ObjectMapper",
+        "/xyz/openbmc_project/object_mapper",
+        "xyz.openbmc_project.ObjectMapper", "GetSubTree", inventoryPath, 0,
+        std::array<const char*, 2>{pfrConfigIface, boardIface});
+}
+
+void ConfigDiscovery::interfacesAdded(sdbusplus::message_t& msg)
+{
+    sdbusplus::message::object_path objPath;
+    InterfaceMap interfaces;
+    try
+    {
+        msg.read(objPath, interfaces);
+    }
+    catch (const std::exception& e)
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "Unable to read InterfacesAdded",
+            phosphor::logging::entry("MSG=%s", e.what()));
+        return;
+    }
+
+    const std::string path = objPath;
+    auto config = interfaces.find(pfrConfigIface);
+    if (config != interfaces.end())
+    {
+        found = found || isBaseboardConfig(path);
+        applyConfig(path, config->second);
+    }
+    else if (interfaces.contains(boardIface) &&
+             boost::ends_with(path, baseboardSuffix))
+    {
+        baseboardFound();
+    }
+}
+
+void ConfigDiscovery::readConfig(const std::string& service,
+                                 const std::string& path)
+{
+    conn->async_method_call(
+        [this, path](boost::system::error_code ec,
+                     const PropertyMap& properties) {
+            if (ec)
+            {
+                phosphor::logging::log<phosphor::logging::level::ERR>(
+                    "Error to Get PFR properties.",
+                    phosphor::logging::entry("MSG=%s", ec.message().c_str()));
+                // Left to the timeout, or to InterfacesAdded on a reload.
+                if (isBaseboardConfig(path) && !decided)
+                {
+                    found = false;
+                }
+                return;
+            }
+            applyConfig(path, properties);
+        },
+        service, path, "org.freedesktop.DBus.Properties", "GetAll",
+        pfrConfigIface);
+}
+
+void ConfigDiscovery::applyConfig(const std::string& path,
+                                  const PropertyMap& properties)
+{
+    const uint64_t* i2cBus = nullptr;
+    const uint64_t* address = nullptr;
+    if (auto it = properties.find("Bus"); it != properties.end())
+    {
+        i2cBus = std::get_if<uint64_t>(&it->second);
+    }
+    if (auto it = properties.find("Address"); it != properties.end())
+    {
+        address = std::get_if<uint64_t>(&it->second);
+    }
+
+    if ((address == nullptr) || (i2cBus == nullptr))
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "Unable to read the pfr properties");
+        return;
+    }
+
+    if (isBaseboardConfig(path))
+    {
+        timer.cancel();
+        decided = true;
+    }
+    onConfig(path, *i2cBus, *address);
+}
+
+bool ConfigDiscovery::isBaseboardConfig(const std::string& path)
+{
+    return boost::ends_with(path, pfrConfigSuffix);
+}
+
+void ConfigDiscovery::baseboardFound()
+{
+    if (found || decided)
+    {
+        return;
+    }
+
+    timer.expires_after(baseboardSettle);
+    timer.async_wait([this](const boost::system::error_code& ec) {
+        if (!ec && !found)
+        {
+            absent("Baseboard has no PFR configuration");
+        }
+    });
+}
+
+void ConfigDiscovery::absent(const std::string& reason)
+{
+    if (decided)
+    {
+        return;
+    }
+    decided = true;
+    phosphor::logging::log<phosphor::logging::level::INFO>(reason.c_str());
+    onAbsent();
+}
+
+} // namespace pfr
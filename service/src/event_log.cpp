@@ -0,0 +1,153 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "event_log.hpp"
+
+#include "event_catalog.hpp"
+#include "format.hpp"
+
+#include <sys/uio.h>
+#include <systemd/sd-journal.h>
+
+#include <array>
+
+namespace pfr
+{
+
+// Constant journal fields of the Redfish events, sent as they are.
+static_assert(LOG_WARNING == 4 && LOG_ERR == 3);
+static constexpr std::string_view priorityWarning = "PRIORITY=4";
+static constexpr std::string_view priorityError = "PRIORITY=3";
+static constexpr std::string_view recoveryMessage =
+    "MESSAGE=Platform firmware recovery occurred.";
+static constexpr std::string_view panicMessage =
+    "MESSAGE=Platform firmware panic occurred.";
+static constexpr std::string_view resiliencyErrorMessage =
+    "MESSAGE=Platform firmware resiliency error occurred.";
+
+static iovec toIovec(std::string_view field)
+{
+    return {const_cast<char*>(field.data()), field.size()};
+}
+
+static void sendRedfishEvent(std::string_view message,
+                             std::string_view priority,
+                             std::string_view messageId,
+                             std::string_view messageArgs,
+                             std::string_view instance)
+{
+    FixedString<96> idField;
+    idField.append("REDFISH_MESSAGE_ID=OpenBMC.0.1.").append(messageId);
+    FixedString<160> argsField;
+    argsField.append("REDFISH_MESSAGE_ARGS=").append(messageArgs);
+    FixedString<64> instanceField;
+    instanceField.append("PFR_INSTANCE=").append(instance);
+    std::array<iovec, 5> fields = {toIovec(message), toIovec(priority),
+                                   toIovec(idField.view()),
+                                   toIovec(argsField.view()),
+                                   toIovec(instanceField.view())};
+    // The instance field is left out for the baseboard CPLD.
+    sd_journal_sendv(fields.data(), instance.empty() ? 4 : 5);
+}
+
+static void logLastRecoveryEvent(const uint8_t reason,
+                                 std::string_view instance)
+{
+    const EventInfo& event = recoveryReasonCatalog[reason];
+    if (event.empty())
+    {
+        // No matching found. So just return without logging event.
+        return;
+    }
+    sendRedfishEvent(recoveryMessage, priorityWarning, event.messageId,
+                     event.reason, instance);
+}
+
+static void logLastPanicEvent(const uint8_t reason, std::string_view instance)
+{
+    const EventInfo& event = panicReasonCatalog[reason];
+    if (event.empty())
+    {
+        // No matching found. So just return without logging event.
+        return;
+    }
+    sendRedfishEvent(panicMessage, priorityWarning, event.messageId,
+                     event.reason, instance);
+}
+
+static void logResiliencyErrorEvent(const uint8_t majorErrorCode,
+                                    const uint8_t minorErrorCode,
+                                    const uint8_t cpldRoTRev,
+                                    std::string_view instance)
+{
+    const EventInfo& event = majorErrorCatalogFor(cpldRoTRev)[majorErrorCode];
+    if (event.empty())
+    {
+        // No matching found. So just return without logging event.
+        return;
+    }
+
+    FixedString<128> errorStr;
+    errorStr.append(event.reason)
+        .append("(MinorCode:0x")
+        .appendHex(minorErrorCode)
+        .append(')');
+    sendRedfishEvent(resiliencyErrorMessage, priorityError, event.messageId,
+                     errorStr.view(), instance);
+}
+
+LastEvents logNewEvents(const LastEvents& last,
+                        const MailboxSnapshot& snapshot,
+                        std::string_view instance)
+{
+    LastEvents current = last;
+
+    if (last.panicCount != snapshot.panicCount)
+    {
+        // Log redfish event by reading reason.
+        current.panicCount = snapshot.panicCount;
+        if (snapshot.panicCount)
+        {
+            logLastPanicEvent(snapshot.panicReason, instance);
+        }
+    }
+
+    if (last.recoveryCount != snapshot.recoveryCount)
+    {
+        // Log redfish event by reading reason.
+        current.recoveryCount = snapshot.recoveryCount;
+        if (snapshot.recoveryCount)
+        {
+            logLastRecoveryEvent(snapshot.recoveryReason, instance);
+        }
+    }
+
+    if ((last.majorErr != snapshot.majorError) ||
+        (last.minorErr != snapshot.minorError))
+    {
+        // Log redfish event by reading reason.
+        current.majorErr = snapshot.majorError;
+        current.minorErr = snapshot.minorError;
+        if (snapshot.majorError && snapshot.minorError)
+        {
+            logResiliencyErrorEvent(snapshot.majorError, snapshot.minorError,
+                                    snapshot.rotRev, instance);
+        }
+    }
+    return current;
+}
+
+} // namespace pfr
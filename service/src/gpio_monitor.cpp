@@ -0,0 +1,115 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "gpio_monitor.hpp"
+
+#include <phosphor-logging/log.hpp>
+
+namespace pfr
+{
+
+GpioEventMonitor::GpioEventMonitor(boost::asio::io_context& io,
+                                   const std::string& name_,
+                                   std::function<void()> handler_,
+                                   std::function<void()> onFailure_) :
+    name(name_), handler(std::move(handler_)),
+    onFailure(std::move(onFailure_)), eventDesc(io)
+{}
+
+GpioEventMonitor::~GpioEventMonitor()
+{
+    // The event fd is owned by the gpiod line.
+    if (eventDesc.is_open())
+    {
+        eventDesc.release();
+    }
+}
+
+bool GpioEventMonitor::start()
+{
+    line = gpiod::find_line(name);
+    if (!line)
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "Failed to find the GPIO line: ",
+            phosphor::logging::entry("MSG=%s", name.c_str()));
+        return false;
+    }
+
+    try
+    {
+        line.request(
+            {"pfr-manager", gpiod::line_request::EVENT_BOTH_EDGES, {}});
+    }
+    catch (const std::exception& e)
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "Failed to request the GPIO line events",
+            phosphor::logging::entry("MSG=%s", e.what()));
+        return false;
+    }
+
+    int fd = line.event_get_fd();
+    if (fd < 0)
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "Failed to get the GPIO line event fd",
+            phosphor::logging::entry("MSG=%s", name.c_str()));
+        line.release();
+        return false;
+    }
+    eventDesc.assign(fd);
+
+    waitForEvent();
+    return true;
+}
+
+void GpioEventMonitor::waitForEvent()
+{
+    eventDesc.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+                         [this](const boost::system::error_code& ec) {
+        if (ec == boost::asio::error::operation_aborted)
+        {
+            // Monitor destroyed.
+            return;
+        }
+        if (ec)
+        {
+            phosphor::logging::log<phosphor::logging::level::ERR>(
+                "GPIO line event wait error",
+                phosphor::logging::entry("MSG=%s", ec.message().c_str()));
+            // Last use of this, the handler may destroy the monitor.
+            onFailure();
+            return;
+        }
+        try
+        {
+            // Consume the event, the handler only needs to know that the
+            // line changed.
+            line.event_read();
+        }
+        catch (const std::exception& e)
+        {
+            phosphor::logging::log<phosphor::logging::level::ERR>(
+                "Failed to read the GPIO line event",
+                phosphor::logging::entry("MSG=%s", e.what()));
+        }
+        handler();
+        waitForEvent();
+    });
+}
+
+} // namespace pfr
@@ -0,0 +1,202 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "last_events.hpp"
+
+#include <phosphor-logging/log.hpp>
+#include <sdbusplus/asio/property.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace pfr
+{
+
+static constexpr const char* settingsService = "xyz.openbmc_project.Settings";
+static constexpr const char* lastEventsPath =
+    "/xyz/openbmc_project/pfr/last_events";
+static constexpr const char* lastEventsIface =
+    "xyz.openbmc_project.PFR.LastEvents";
+
+// "PFRE"
+static constexpr uint32_t stateMagic = 0x45524650;
+
+static constexpr std::chrono::seconds retryDelayMin(1);
+static constexpr std::chrono::seconds retryDelayMax(32);
+
+LastEventsShadow::LastEventsShadow(const std::string& path)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(
+        std::filesystem::path(path).parent_path(), ec);
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "PFR: Unable to open last events state file",
+            phosphor::logging::entry("MSG=%s", std::strerror(errno)));
+        return;
+    }
+
+    // A new or short file reads as zeros, which is not a valid record.
+    struct stat st;
+    if ((fstat(fd, &st) != 0) ||
+        ((static_cast<size_t>(st.st_size) < sizeof(StateRecord)) &&
+         (ftruncate(fd, sizeof(StateRecord)) != 0)))
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "PFR: Unable to size last events state file",
+            phosphor::logging::entry("MSG=%s", std::strerror(errno)));
+        close(fd);
+        return;
+    }
+
+    void* map = mmap(nullptr, sizeof(StateRecord), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "PFR: Unable to map last events state file",
+            phosphor::logging::entry("MSG=%s", std::strerror(errno)));
+        return;
+    }
+
+    record = static_cast<StateRecord*>(map);
+    if ((record->magic == stateMagic) &&
+        (record->check == checkOf(record->events)))
+    {
+        events = record->events;
+        valid = true;
+    }
+}
+
+LastEventsShadow::~LastEventsShadow()
+{
+    if (record != nullptr)
+    {
+        munmap(record, sizeof(StateRecord));
+    }
+}
+
+void LastEventsShadow::set(const LastEvents& events_)
+{
+    events = events_;
+    valid = true;
+    if (record == nullptr)
+    {
+        return;
+    }
+    record->magic = stateMagic;
+    record->events = events;
+    record->check = checkOf(events);
+    // The page cache outlives the process, write-back is up to the kernel.
+    msync(record, sizeof(StateRecord), MS_ASYNC);
+}
+
+uint32_t LastEventsShadow::checkOf(const LastEvents& events)
+{
+    static_assert(sizeof(LastEvents) == sizeof(uint32_t));
+    uint32_t packed = 0;
+    std::memcpy(&packed, &events, sizeof(packed));
+    return ~packed;
+}
+
+LastEventsWriter::LastEventsWriter(
+    boost::asio::io_context& io,
+    std::shared_ptr<sdbusplus::asio::connection> conn_) :
+    conn(std::move(conn_)), retryTimer(io), retryDelay(retryDelayMin)
+{}
+
+void LastEventsWriter::set(const std::string& name, const uint8_t value)
+{
+    queued[name] = value;
+}
+
+void LastEventsWriter::flush()
+{
+    if (outstanding != 0 || retryPending || queued.empty())
+    {
+        return;
+    }
+    write();
+}
+
+void LastEventsWriter::write()
+{
+    inFlight = std::move(queued);
+    queued.clear();
+    batchFailed = false;
+    // All Sets of the batch are sent back to back, without waiting for
+    // each reply.
+    outstanding = inFlight.size();
+    for (const auto& [name, value] : inFlight)
+    {
+        sdbusplus::asio::setProperty(
+            *conn, settingsService, lastEventsPath, lastEventsIface, name,
+            value,
+            [this, name = name,
+             value = value](const boost::system::error_code& ec) {
+                if (ec)
+                {
+                    phosphor::logging::log<phosphor::logging::level::ERR>(
+                        "PFR: Unable to update last events",
+                        phosphor::logging::entry("NAME=%s", name.c_str()),
+                        phosphor::logging::entry("MSG=%s",
+                                                 ec.message().c_str()));
+                    // Retried, unless a newer value is queued already.
+                    queued.try_emplace(name, value);
+                    batchFailed = true;
+                }
+                batchDone();
+            });
+    }
+}
+
+void LastEventsWriter::batchDone()
+{
+    if (--outstanding != 0)
+    {
+        return;
+    }
+    inFlight.clear();
+
+    if (!batchFailed)
+    {
+        retryDelay = retryDelayMin;
+        flush();
+        return;
+    }
+
+    retryPending = true;
+    retryTimer.expires_after(retryDelay);
+    retryDelay = std::min(retryDelay * 2, retryDelayMax);
+    retryTimer.async_wait([this](const boost::system::error_code& ec) {
+        retryPending = false;
+        if (!ec)
+        {
+            flush();
+        }
+    });
+}
+
+} // namespace pfr
@@ -14,33 +14,95 @@
 // limitations under the License.
 */
 
+#include "busQueues.hpp"
+#include "config_discovery.hpp"
+#include "event_log.hpp"
+#include "gpio_monitor.hpp"
+#include "last_events.hpp"
 #include "pfr.hpp"
+#include "pfr_instance.hpp"
 #include "pfr_mgr.hpp"
+#include "poll_scheduler.hpp"
+#include "simCpld.hpp"
 
-#include <systemd/sd-journal.h>
 #include <unistd.h>
 
 #include <boost/asio.hpp>
 #include <sdbusplus/asio/property.hpp>
 #include <sdbusplus/unpack_properties.hpp>
 
+#include <chrono>
+#include <future>
+#include <map>
+#include <string_view>
+
 namespace pfr
 {
 
-static bool i2cConfigLoaded = false;
-static int retrCount = 10;
+// PFR confirmed by the presence strap or the PFR configuration.
+static bool pfrSupportConfirmed = false;
 
 static bool stateTimerRunning = false;
-bool bmcBootCompleteChkPointDone = false;
-bool unProvChkPointStatus = false;
+static bool bmcBootCompleteChkPointDone = false;
+static bool bmcBootCompleteChkPointPending = false;
+static bool unProvChkPointStatus = false;
 static constexpr uint8_t bmcBootFinishedChkPoint = 0x09;
-
+static constexpr unsigned int mailboxWriteRetries = 3;
+
+// Queue of the baseboard CPLD mailbox bus.
+std::unique_ptr<IoExecutor> ioExecutor = nullptr;
+std::unique_ptr<BusQueues> busQueues = nullptr;
+std::unique_ptr<GpioEventMonitor> alertMonitor = nullptr;
+static PollScheduler pollScheduler(
+    std::chrono::milliseconds(PFR_POLL_MIN_MS),
+    std::chrono::milliseconds(PFR_POLL_MAX_MS),
+    std::chrono::milliseconds(PFR_POLL_IDLE_MS), PFR_POLL_BUDGET);
 std::unique_ptr<boost::asio::steady_timer> stateTimer = nullptr;
 std::unique_ptr<boost::asio::steady_timer> initTimer = nullptr;
-std::unique_ptr<boost::asio::steady_timer> pfrObjTimer = nullptr;
+std::unique_ptr<ConfigDiscovery> configDiscovery = nullptr;
+std::unique_ptr<LastEventsShadow> lastEventsShadow = nullptr;
+std::unique_ptr<LastEventsWriter> lastEventsWriter = nullptr;
 std::vector<std::unique_ptr<PfrVersion>> pfrVersionObjects;
+std::vector<std::unique_ptr<PfrPfm>> pfrPfmObjects;
+std::unique_ptr<PfrRecoveryVerify> pfrRecoveryVerifyObject;
 std::unique_ptr<PfrConfig> pfrConfigObject;
 std::unique_ptr<PfrPostcode> pfrPostcodeObject;
+std::unique_ptr<PfrTiming> pfrTimingObject;
+std::unique_ptr<PfrMetrics> pfrMetricsObject;
+// Other nodes of a multi-node platform, by PFR configuration path.
+std::map<std::string, std::unique_ptr<PfrInstance>> pfrInstances;
+// Node records published before the baseboard one, created once the
+// baseboard mailbox bus is known. <bus, address> by path.
+static std::map<std::string, std::pair<uint64_t, uint64_t>> pendingInstances;
+static bool baseboardConfigured = false;
+
+// Origin is set during static initialization, right after process start.
+static PhaseLog startupLog;
+
+// Hardware state read once at startup, the startup objects are all built
+// from it.
+struct StartupSnapshot
+{
+    MailboxRegisters mailbox;
+    // RoT answered, the registers are from a PFR CPLD.
+    bool valid = false;
+    // Mailbox the registers were read from, the default one as the
+    // configuration is not loaded yet.
+    uint64_t i2cBus = 0;
+    uint64_t address = 0;
+    std::map<ImageType, std::string> versions;
+};
+static StartupSnapshot startupSnapshot;
+
+// Registers of the startup snapshot are those of the configured CPLD.
+static bool startupSnapshotCurrent()
+{
+    uint64_t i2cBus = 0;
+    uint64_t address = 0;
+    getMailboxAddress(i2cBus, address);
+    return startupSnapshot.valid && (startupSnapshot.i2cBus == i2cBus) &&
+           (startupSnapshot.address == address);
+}
 
 // List holds <ObjPath> <ImageType> <VersionPurpose>
 static std::vector<std::tuple<std::string, ImageType, std::string>>
@@ -57,202 +119,148 @@ static std::vector<std::tuple<std::string, ImageType, std::string>>
                         versionPurposeOther),
 };
 
-// Recovery reason map.
-// {<CPLD association>,{<Redfish MessageID>, <Recovery Reason>}}
-static const boost::container::flat_map<uint8_t,
-                                        std::pair<std::string, std::string>>
-    recoveryReasonMap = {
-        {0x01,
-         {"BIOSFirmwareRecoveryReason",
-          "BIOS active image authentication failure"}},
-        {0x02,
-         {"BIOSFirmwareRecoveryReason",
-          "BIOS recovery image authentication failure"}},
-        {0x03, {"MEFirmwareRecoveryReason", "ME launch failure"}},
-        {0x04, {"BIOSFirmwareRecoveryReason", "ACM launch failure"}},
-        {0x05, {"BIOSFirmwareRecoveryReason", "IBB launch failure"}},
-        {0x06, {"BIOSFirmwareRecoveryReason", "OBB launch failure"}},
-        {0x07,
-         {"BMCFirmwareRecoveryReason",
-          "BMC active image authentication failure"}},
-        {0x08,
-         {"BMCFirmwareRecoveryReason",
-          "BMC recovery image authentication failure"}},
-        {0x09, {"BMCFirmwareRecoveryReason", "BMC launch failure"}},
-        {0x0A, {"CPLDFirmwareRecoveryReason", "CPLD watchdog expired"}},
-        {0x0B, {"BMCFirmwareRecoveryReason", "BMC attestation failure"}},
-        {0x0C, {"FirmwareResiliencyError", "CPU0  attestation failure"}},
-        {0x0D, {"FirmwareResiliencyError", "CPU1  attestation failure"}}};
-
-// Panic Reason map.
-// {<CPLD association>, {<Redfish MessageID>, <Panic reason> })
-static const boost::container::flat_map<uint8_t,
-                                        std::pair<std::string, std::string>>
-    panicReasonMap = {
-        {0x01, {"BIOSFirmwarePanicReason", "BIOS update intent"}},
-        {0x02, {"BMCFirmwarePanicReason", "BMC update intent"}},
-        {0x03, {"BMCFirmwarePanicReason", "BMC reset detected"}},
-        {0x04, {"BMCFirmwarePanicReason", "BMC watchdog expired"}},
-        {0x05, {"MEFirmwarePanicReason", "ME watchdog expired"}},
-        {0x06, {"BIOSFirmwarePanicReason", "ACM/IBB/OBB WDT expired"}},
-        {0x09,
-         {"BIOSFirmwarePanicReason",
-          "ACM or IBB or OBB authentication failure"}},
-        {0x0A, {"FirmwareResiliencyError", "Attestation failure"}}};
-
-// Firmware resiliency major map.
-// {<CPLD association>, {<Redfish MessageID>, <Error reason> })
-static const boost::container::flat_map<uint8_t,
-                                        std::pair<std::string, std::string>>
-    majorErrorCodeMap = {
-        {0x01,
-         {"BMCFirmwareResiliencyError", "BMC image authentication failed"}},
-        {0x02,
-         {"BIOSFirmwareResiliencyError", "BIOS image authentication failed"}},
-        {0x03,
-         {"BIOSFirmwareResiliencyError", "in-band and oob update failure"}},
-        {0x04, {"BMCFirmwareResiliencyError", "Communication setup failed"}},
-        {0x05,
-         {"FirmwareResiliencyError",
-          "Attestation measurement mismatch-Attestation failure"}},
-        {0x06, {"FirmwareResiliencyError", "Attestation challenge timeout"}},
-        {0x07, {"FirmwareResiliencyError", "SPDM protocol timeout"}},
-        {0x08, {"FirmwareResiliencyError", "I2c Communication failure"}},
-        {0x09,
-         {"CPLDFirmwareResiliencyError",
-          "Combined CPLD authentication failure"}},
-        {0x0A, {"CPLDFirmwareResiliencyError", "Combined CPLD update failure"}},
-        {0x0B,
-         {"CPLDFirmwareResiliencyError", "Combined CPLD recovery failure"}},
-        {0x10, {"FirmwareResiliencyError", "Image copy Failed"}}};
-
-static void updateDbusPropertiesCache()
-{
-    for (const auto& pfrVerObj : pfrVersionObjects)
-    {
-        pfrVerObj->updateVersion();
-    }
-
-    // Update provisoningStatus properties
-    pfrConfigObject->updateProvisioningStatus();
-
-    phosphor::logging::log<phosphor::logging::level::INFO>(
-        "PFR Manager service cache data updated.");
-}
-
-static void logLastRecoveryEvent()
+// Images read from the BMC flash, the others from the CPLD mailbox.
+static bool isSpiImage(const ImageType& imgType)
 {
-    uint8_t reason = 0;
-    if (0 != readCpldReg(ActionType::recoveryReason, reason))
-    {
-        return;
-    }
-
-    auto it = recoveryReasonMap.find(reason);
-    if (it == recoveryReasonMap.end())
-    {
-        // No matching found. So just return without logging event.
-        return;
-    }
-    std::string msgId = "OpenBMC.0.1." + it->second.first;
-    sd_journal_send("MESSAGE=%s", "Platform firmware recovery occurred.",
-                    "PRIORITY=%i", LOG_WARNING, "REDFISH_MESSAGE_ID=%s",
-                    msgId.c_str(), "REDFISH_MESSAGE_ARGS=%s",
-                    it->second.second.c_str(), NULL);
+    return (imgType == ImageType::bmcActive) ||
+           (imgType == ImageType::bmcRecovery);
 }
 
-static void logLastPanicEvent()
+static void recordStartupPhase(const std::string& name,
+                               const PhaseLog::Clock::time_point& begin)
 {
-    uint8_t reason = 0;
-    if (0 != readCpldReg(ActionType::panicReason, reason))
+    startupLog.record(name, begin);
+    if (pfrTimingObject)
     {
-        return;
-    }
-
-    auto it = panicReasonMap.find(reason);
-    if (it == panicReasonMap.end())
-    {
-        // No matching found. So just return without logging event.
-        return;
+        pfrTimingObject->setStartupPhases(startupLog);
     }
-
-    std::string msgId = "OpenBMC.0.1." + it->second.first;
-    sd_journal_send("MESSAGE=%s", "Platform firmware panic occurred.",
-                    "PRIORITY=%i", LOG_WARNING, "REDFISH_MESSAGE_ID=%s",
-                    msgId.c_str(), "REDFISH_MESSAGE_ARGS=%s",
-                    it->second.second.c_str(), NULL);
 }
 
-static void logResiliencyErrorEvent(const uint8_t majorErrorCode,
-                                    const uint8_t minorErrorCode)
+static void updateDbusPropertiesCache()
 {
-    uint8_t cpldRoTRev = 0;
-    if (0 != readCpldReg(ActionType::readRoTRev, cpldRoTRev))
-    {
-        return;
-    }
-
-    auto it = majorErrorCodeMap.find(majorErrorCode);
-    if (cpldRoTRev == 0x02)
-    {
-        auto itRev2 = majorErrorCodeMapRev2.find(majorErrorCode);
-        if (itRev2 != majorErrorCodeMapRev2.end())
+    auto begin = PhaseLog::Clock::now();
+    auto refresh = std::make_shared<PhaseLog>(begin);
+    // Readers fan out over the bus queues, published once the last one is
+    // done.
+    auto pending = std::make_shared<size_t>(pfrVersionObjects.size() + 1 +
+                                            pfrInstances.size());
+    auto done = [refresh, pending, begin](const std::string& name) {
+        refresh->record(name, begin);
+        if (--*pending != 0)
         {
-            it = itRev2;
+            return;
         }
-        else if (it == majorErrorCodeMap.end())
+        if (pfrTimingObject)
         {
-            // No matching found. So just return without logging event.
-            return;
+            pfrTimingObject->setRefreshPhases(*refresh);
         }
-    }
-    else if (it == majorErrorCodeMap.end())
+        lg2::info("PFR Manager service cache data updated in {MS} ms: "
+                  "{PHASES}",
+                  "MS", refresh->elapsed() / 1000, "PHASES",
+                  refresh->summary());
+    };
+
+    for (const auto& pfrVerObj : pfrVersionObjects)
     {
-        // No matching found. So just return without logging event.
-        return;
+        pfrVerObj->updateVersion(
+            [done, name = pfrVerObj->getName()]() { done(name); });
     }
 
-    std::string errorStr =
-        it->second.second + "(MinorCode:0x" + toHexString(minorErrorCode) + ")";
-    std::string msgId = "OpenBMC.0.1." + it->second.first;
-    sd_journal_send(
-        "MESSAGE=%s", "Platform firmware resiliency error occurred.",
-        "PRIORITY=%i", LOG_ERR, "REDFISH_MESSAGE_ID=%s", msgId.c_str(),
-        "REDFISH_MESSAGE_ARGS=%s", errorStr.c_str(), NULL);
+    // Update provisoningStatus properties
+    pfrConfigObject->updateProvisioningStatus(
+        [done]() { done("Provisioning"); });
+
+    for (const auto& [path, instance] : pfrInstances)
+    {
+        instance->refresh(
+            [done, name = instance->getName()]() { done(name); });
+    }
 }
 
-static void handleLastCountChange(
-    std::shared_ptr<sdbusplus::asio::connection> conn, std::string eventName,
-    uint8_t currentCount)
+// Survives service restarts, not BMC firmware updates.
+static constexpr const char* lastEventsStateFile =
+    "/var/lib/pfr-manager/last_events";
+
+static void readAndLogEvents(const PhaseLog::Clock::time_point& begin)
 {
-    sdbusplus::asio::setProperty(
-        *conn, "xyz.openbmc_project.Settings",
-        "/xyz/openbmc_project/pfr/last_events",
-        "xyz.openbmc_project.PFR.LastEvents", eventName, currentCount,
-        [](boost::system::error_code ec) {
-            if (ec)
+    static bool firstCheckDone = false;
+
+    // Counts, reasons and error codes are decoded from one block
+    // read so that a count and its reason are always consistent.
+    ioExecutor->post(
+        []() {
+            MailboxSnapshot snapshot{};
+            int ret = readMailboxSnapshot(snapshot);
+            return std::make_pair(ret, snapshot);
+        },
+        [begin](const std::pair<int, MailboxSnapshot>& result) {
+            const auto& [ret, snapshot] = result;
+            if (ret != 0)
             {
-                phosphor::logging::log<phosphor::logging::level::ERR>(
-                    "PFR: Unable to update currentCount",
-                    phosphor::logging::entry("MSG=%s", ec.message().c_str()));
                 return;
             }
-        });
-    return;
+            if (!firstCheckDone)
+            {
+                firstCheckDone = true;
+                recordStartupPhase("FirstEventCheck", begin);
+            }
+            pollScheduler.observe(snapshot.platformState);
+            if (pfrPostcodeObject)
+            {
+                pfrPostcodeObject->recordPlatformState(snapshot.platformState);
+            }
+
+            const LastEvents& last = lastEventsShadow->get();
+            LastEvents current = logNewEvents(last, snapshot);
+            if (current == last)
+            {
+                return;
+            }
+
+            // Update cached data to dbus.
+            if (current.panicCount != last.panicCount)
+            {
+                lastEventsWriter->set("lastPanicCount", current.panicCount);
+            }
+            if (current.recoveryCount != last.recoveryCount)
+            {
+                lastEventsWriter->set("lastRecoveryCount",
+                                      current.recoveryCount);
+            }
+            if ((current.majorErr != last.majorErr) ||
+                (current.minorErr != last.minorErr))
+            {
+                lastEventsWriter->set("lastMajorErr", current.majorErr);
+                lastEventsWriter->set("lastMinorErr", current.minorErr);
+            }
+            lastEventsShadow->set(current);
+            // All changes of this poll in one update.
+            lastEventsWriter->flush();
+        },
+        Priority::polling);
 }
 
-static void checkAndLogEvents(
-    std::shared_ptr<sdbusplus::asio::connection>& conn)
+// Without a state file, e.g. on the first start of this version, the
+// last events are taken from Settings once.
+static void loadLastEvents(std::shared_ptr<sdbusplus::asio::connection>& conn,
+                           const PhaseLog::Clock::time_point& begin)
 {
+    static bool loading = false;
+    if (loading)
+    {
+        return;
+    }
+    loading = true;
     sdbusplus::asio::getAllProperties(
         *conn, "xyz.openbmc_project.Settings",
         "/xyz/openbmc_project/pfr/last_events",
         "xyz.openbmc_project.PFR.LastEvents",
-        [conn](
+        [begin](
             boost::system::error_code ec,
             const std::vector<
                 std::pair<std::string, std::variant<std::monostate, uint8_t>>>&
                 properties) {
+            loading = false;
             if (ec)
             {
                 phosphor::logging::log<phosphor::logging::level::ERR>(
@@ -260,17 +268,14 @@ static void checkAndLogEvents(
                     phosphor::logging::entry("MSG=%s", ec.message().c_str()));
                 return;
             }
-            uint8_t lastRecoveryCount = 0;
-            uint8_t lastPanicCount = 0;
-            uint8_t lastMajorErr = 0;
-            uint8_t lastMinorErr = 0;
+            LastEvents events;
 
             try
             {
                 sdbusplus::unpackProperties(
-                    properties, "lastRecoveryCount", lastRecoveryCount,
-                    "lastPanicCount", lastPanicCount, "lastMajorErr",
-                    lastMajorErr, "lastMinorErr", lastMinorErr);
+                    properties, "lastRecoveryCount", events.recoveryCount,
+                    "lastPanicCount", events.panicCount, "lastMajorErr",
+                    events.majorErr, "lastMinorErr", events.minorErr);
             }
             catch (const sdbusplus::exception::UnpackPropertyError& error)
             {
@@ -280,64 +285,37 @@ static void checkAndLogEvents(
                 return;
             }
 
-            uint8_t currPanicCount = 0;
-            if (0 == readCpldReg(ActionType::panicCount, currPanicCount))
-            {
-                if (lastPanicCount != currPanicCount)
-                {
-                    // Update cached data to dbus and log redfish
-                    // event by reading reason.
-                    handleLastCountChange(conn, "lastPanicCount",
-                                          currPanicCount);
-                    if (currPanicCount)
-                    {
-                        logLastPanicEvent();
-                    }
-                }
-            }
-
-            uint8_t currRecoveryCount = 0;
-            if (0 == readCpldReg(ActionType::recoveryCount, currRecoveryCount))
-            {
-                if (lastRecoveryCount != currRecoveryCount)
-                {
-                    // Update cached data to dbus and log redfish
-                    // event by reading reason.
-                    handleLastCountChange(conn, "lastRecoveryCount",
-                                          currRecoveryCount);
-                    if (currRecoveryCount)
-                    {
-                        logLastRecoveryEvent();
-                    }
-                }
-            }
-
-            uint8_t majorErr = 0;
-            uint8_t minorErr = 0;
-            if ((0 == readCpldReg(ActionType::majorError, majorErr)) &&
-                (0 == readCpldReg(ActionType::minorError, minorErr)))
-            {
-                if ((lastMajorErr != majorErr) || (lastMinorErr != minorErr))
-                {
-                    // Update cached data to dbus and log redfish event by
-                    // reading reason.
-                    handleLastCountChange(conn, "lastMajorErr", majorErr);
-                    handleLastCountChange(conn, "lastMinorErr", minorErr);
-                    if (majorErr && minorErr)
-                    {
-                        logResiliencyErrorEvent(majorErr, minorErr);
-                    }
-                }
-            }
+            lastEventsShadow->set(events);
+            readAndLogEvents(begin);
         });
 }
 
+static void checkAndLogEvents(
+    std::shared_ptr<sdbusplus::asio::connection>& conn)
+{
+    auto begin = PhaseLog::Clock::now();
+    if (!lastEventsShadow->loaded())
+    {
+        loadLastEvents(conn, begin);
+        return;
+    }
+    readAndLogEvents(begin);
+}
+
 static void monitorPlatformStateChange(
     sdbusplus::asio::object_server& server,
     std::shared_ptr<sdbusplus::asio::connection>& conn)
 {
-    constexpr size_t pollTimeout = 10; // seconds
-    stateTimer->expires_after(std::chrono::seconds(pollTimeout));
+    auto interval = pollScheduler.next();
+    if (alertMonitor)
+    {
+        // Events are read on CPLD alert edges, only audit at the idle
+        // rate in case an edge is missed.
+        interval = std::max(interval,
+                            PollScheduler::Interval(PFR_POLL_IDLE_MS));
+    }
+
+    stateTimer->expires_after(interval);
     stateTimer->async_wait(
         [&server, &conn](const boost::system::error_code& ec) {
             if (ec == boost::asio::error::operation_aborted)
@@ -355,6 +333,59 @@ static void monitorPlatformStateChange(
         });
 }
 
+// Power on or host start, poll fast until the platform settles.
+static void startPolling(sdbusplus::asio::object_server& server,
+                         std::shared_ptr<sdbusplus::asio::connection>& conn)
+{
+    pollScheduler.setActive();
+    stateTimerRunning = true;
+    monitorPlatformStateChange(server, conn);
+}
+
+// Host booted or powered off, check now and keep a low rate audit.
+static void idlePolling(sdbusplus::asio::object_server& server,
+                        std::shared_ptr<sdbusplus::asio::connection>& conn)
+{
+    checkAndLogEvents(conn);
+    pollScheduler.setIdle();
+    if (!stateTimerRunning)
+    {
+        stateTimerRunning = true;
+        monitorPlatformStateChange(server, conn);
+    }
+}
+
+static void setBootCompleteCheckpoint()
+{
+    if (bmcBootCompleteChkPointDone || bmcBootCompleteChkPointPending)
+    {
+        return;
+    }
+    bmcBootCompleteChkPointPending = true;
+    auto begin = PhaseLog::Clock::now();
+    ioExecutor->postWithRetry(
+        []() { return setBMCBootCompleteChkPoint(bmcBootFinishedChkPoint); },
+        [begin](const int ret) {
+            bmcBootCompleteChkPointPending = false;
+            if (ret != 0)
+            {
+                return;
+            }
+            bmcBootCompleteChkPointDone = true;
+            recordStartupPhase("BootCheckpoint", begin);
+            lg2::info("PFR Manager startup phases: {PHASES}", "PHASES",
+                      startupLog.summary());
+            if (unProvChkPointStatus)
+            {
+                unProvChkPointStatus = false;
+                phosphor::logging::log<phosphor::logging::level::INFO>(
+                    "PFR is not provisioned, hence exit the service.");
+                std::exit(EXIT_SUCCESS);
+            }
+        },
+        mailboxWriteRetries, Priority::critical);
+}
+
 void checkAndSetCheckpoint(sdbusplus::asio::object_server& server,
                            std::shared_ptr<sdbusplus::asio::connection>& conn)
 {
@@ -370,7 +401,7 @@ void checkAndSetCheckpoint(sdbusplus::asio::object_server& server,
                         "BMC boot completed. Setting checkpoint 9.");
                     if (!bmcBootCompleteChkPointDone)
                     {
-                        setBMCBootCompleteChkPoint(bmcBootFinishedChkPoint);
+                        setBootCompleteCheckpoint();
                     }
                     return;
                 }
@@ -412,6 +443,43 @@ void checkAndSetCheckpoint(sdbusplus::asio::object_server& server,
         "org.freedesktop.systemd1.Manager", "FinishTimestamp");
 }
 
+static void startAlertMonitor(
+    sdbusplus::asio::object_server& server,
+    std::shared_ptr<sdbusplus::asio::connection>& conn)
+{
+    if (alertMonitor || std::string_view(PFR_ALERT_GPIO).empty())
+    {
+        return;
+    }
+
+    auto monitor = std::make_unique<GpioEventMonitor>(
+        conn->get_io_context(), PFR_ALERT_GPIO,
+        [&conn]() { checkAndLogEvents(conn); },
+        [&server, &conn]() {
+            // Not from within the monitor, it is destroyed here.
+            boost::asio::post(conn->get_io_context(), [&server, &conn]() {
+                phosphor::logging::log<phosphor::logging::level::ERR>(
+                    "PFR alert GPIO failed, polling for events.");
+                alertMonitor.reset();
+                stateTimerRunning = true;
+                monitorPlatformStateChange(server, conn);
+            });
+        });
+    if (!monitor->start())
+    {
+        phosphor::logging::log<phosphor::logging::level::ERR>(
+            "PFR alert GPIO unavailable, polling for events.");
+        return;
+    }
+    alertMonitor = std::move(monitor);
+
+    if (stateTimerRunning)
+    {
+        // Rearmed at the audit rate.
+        monitorPlatformStateChange(server, conn);
+    }
+}
+
 void monitorSignals(sdbusplus::asio::object_server& server,
                     std::shared_ptr<sdbusplus::asio::connection>& conn)
 {
@@ -428,14 +496,13 @@ void monitorSignals(sdbusplus::asio::object_server& server,
                 phosphor::logging::log<phosphor::logging::level::INFO>(
                     "BMC boot completed(StartupFinished). Setting "
                     "checkpoint 9.");
-                setBMCBootCompleteChkPoint(bmcBootFinishedChkPoint);
+                setBootCompleteCheckpoint();
             }
         });
     checkAndSetCheckpoint(server, conn);
 
-    // Capture the Chassis state and Start the monitor timer
-    // if state changed to 'On'. Run timer until  OS boot.
-    // Stop timer if state changed to 'Off'.
+    // Capture the Chassis state and poll fast if state changed to 'On'.
+    // Drop to the idle audit rate if state changed to 'Off'.
     static auto matchChassisState = sdbusplus::bus::match_t(
         static_cast<sdbusplus::bus_t&>(*conn),
         "type='signal',member='PropertiesChanged', "
@@ -454,20 +521,21 @@ void monitorSignals(sdbusplus::asio::object_server& server,
                     std::get_if<std::string>(&it->second);
                 if (state != nullptr)
                 {
-                    if ((*state ==
-                         "xyz.openbmc_project.State.Chassis.PowerState.On") &&
-                        (!stateTimerRunning))
+                    if (*state ==
+                        "xyz.openbmc_project.State.Chassis.PowerState.On")
                     {
-                        stateTimerRunning = true;
-                        monitorPlatformStateChange(server, conn);
+                        startPolling(server, conn);
+#ifdef PFR_BOOT_PROFILE
+                        if (pfrPostcodeObject)
+                        {
+                            pfrPostcodeObject->startBootProfile();
+                        }
+#endif
                     }
-                    else if ((*state == "xyz.openbmc_project.State.Chassis."
-                                        "PowerState.Off") &&
-                             (stateTimerRunning))
+                    else if (*state == "xyz.openbmc_project.State.Chassis."
+                                       "PowerState.Off")
                     {
-                        stateTimer->cancel();
-                        checkAndLogEvents(conn);
-                        stateTimerRunning = false;
+                        idlePolling(server, conn);
                     }
                 }
 
@@ -476,9 +544,8 @@ void monitorSignals(sdbusplus::asio::object_server& server,
             }
         });
 
-    // Capture the Host state and Start the monitor timer
-    // if state changed to 'Running'. Run timer until OS boot.
-    // Stop timer if state changed to 'Off'.
+    // Capture the Host state and poll fast if state changed to 'Running'.
+    // Drop to the idle audit rate if state changed to 'Off'.
     static auto matchHostState = sdbusplus::bus::match_t(
         static_cast<sdbusplus::bus_t&>(*conn),
         "type='signal',member='PropertiesChanged', "
@@ -497,22 +564,17 @@ void monitorSignals(sdbusplus::asio::object_server& server,
                     std::get_if<std::string>(&it->second);
                 if (state != nullptr)
                 {
-                    if ((*state ==
-                         "xyz.openbmc_project.State.Host.HostState.Running") &&
-                        (!stateTimerRunning))
+                    if (*state ==
+                        "xyz.openbmc_project.State.Host.HostState.Running")
                     {
-                        stateTimerRunning = true;
-                        monitorPlatformStateChange(server, conn);
+                        startPolling(server, conn);
                     }
-                    else if (((*state == "xyz.openbmc_project.State.Host."
-                                         "HostState.Off") ||
-                              (*state == "xyz.openbmc_project.State.Host."
-                                         "HostState.Quiesced")) &&
-                             (stateTimerRunning))
+                    else if ((*state == "xyz.openbmc_project.State.Host."
+                                        "HostState.Off") ||
+                             (*state == "xyz.openbmc_project.State.Host."
+                                        "HostState.Quiesced"))
                     {
-                        stateTimer->cancel();
-                        checkAndLogEvents(conn);
-                        stateTimerRunning = false;
+                        idlePolling(server, conn);
                     }
                 }
 
@@ -521,9 +583,9 @@ void monitorSignals(sdbusplus::asio::object_server& server,
             }
         });
 
-    // Capture the OS state change and stop monitor timer
+    // Capture the OS state change and drop to the idle audit rate
     // if OS boots completely or becomes Inactive.
-    // start timer in other cases to mnitor states.
+    // Poll fast in other cases to monitor states.
     static auto matchOsState = sdbusplus::bus::match_t(
         static_cast<sdbusplus::bus_t&>(*conn),
         "type='signal',member='PropertiesChanged', "
@@ -551,17 +613,13 @@ void monitorSignals(sdbusplus::asio::object_server& server,
                                     "Status.OSStatus.BootComplete") ||
                          (*state == "Inactive") ||
                          (*state == "xyz.openbmc_project.State.OperatingSystem."
-                                    "Status.OSStatus.Inactive")) &&
-                        (stateTimerRunning))
+                                    "Status.OSStatus.Inactive")))
                     {
-                        stateTimer->cancel();
-                        checkAndLogEvents(conn);
-                        stateTimerRunning = false;
+                        idlePolling(server, conn);
                     }
-                    else if (!stateTimerRunning)
+                    else
                     {
-                        stateTimerRunning = true;
-                        monitorPlatformStateChange(server, conn);
+                        startPolling(server, conn);
                     }
                 }
             }
@@ -569,11 +627,21 @@ void monitorSignals(sdbusplus::asio::object_server& server,
 
     // First time, check and log events if any.
     checkAndLogEvents(conn);
+
+    // Read events on CPLD alert edges when the line is configured,
+    // otherwise keep a low rate audit until a power state change.
+    startAlertMonitor(server, conn);
+    pollScheduler.setIdle();
+    if (!stateTimerRunning)
+    {
+        stateTimerRunning = true;
+        monitorPlatformStateChange(server, conn);
+    }
 }
 
-static void updateCPLDversion(std::shared_ptr<sdbusplus::asio::connection> conn)
+static void setCPLDversion(std::shared_ptr<sdbusplus::asio::connection> conn,
+                           const std::string& cpldVersion)
 {
-    std::string cpldVersion = pfr::readCPLDVersion();
     lg2::info("VERSION INFO - rot_fw_active - {VER}", "VER", cpldVersion);
     conn->async_method_call(
         [](const boost::system::error_code ec) {
@@ -590,133 +658,335 @@ static void updateCPLDversion(std::shared_ptr<sdbusplus::asio::connection> conn)
         "org.freedesktop.DBus.Properties", "Set",
         "xyz.openbmc_project.Software.Version", "Version",
         std::variant<std::string>(cpldVersion));
+}
+
+static void updateCPLDversion(std::shared_ptr<sdbusplus::asio::connection> conn)
+{
+    ioExecutor->post([]() { return pfr::readCPLDVersion(); },
+                     [conn](const std::string& cpldVersion) {
+                         setCPLDversion(conn, cpldVersion);
+                     });
     return;
 }
 
-void checkPfrInterface(std::shared_ptr<sdbusplus::asio::connection> conn,
+void checkPfrInterface(std::shared_ptr<sdbusplus::asio::connection>& conn,
                        sdbusplus::asio::object_server& server)
 {
-    if (!i2cConfigLoaded)
-    {
-        init(conn, i2cConfigLoaded);
-        if (retrCount > 0)
-        {
-            // pfr object not loaded yet. query again.
-            return;
-        }
-        else
+    auto begin = PhaseLog::Clock::now();
+    auto onProvisioning = [&server, &conn, begin](const bool provisioned) {
+        recordStartupPhase("ProvisioningCheck", begin);
+        if (provisioned)
         {
-            // Platform does not contain pfr object. Stop the service.
+            // pfr provisioned.
             phosphor::logging::log<phosphor::logging::level::INFO>(
-                "Platform does not support PFR, hence stop the "
-                "service.");
-            std::exit(EXIT_SUCCESS);
+                "PFR Supported.");
             return;
         }
-    }
-    else
-    {
-        retrCount = 0;
+        unProvChkPointStatus = true;
+        pfr::monitorSignals(server, conn);
+    };
 
+    if (startupSnapshotCurrent())
+    {
         bool locked = false;
         bool prov = false;
         bool support = false;
-        pfr::getProvisioningStatus(locked, prov, support);
-        if (support && prov)
-        {
-            // pfr provisioned.
-            phosphor::logging::log<phosphor::logging::level::INFO>(
-                "PFR Supported.");
-            return;
-        }
-        else
-        {
-            unProvChkPointStatus = true;
-            pfr::monitorSignals(server, conn);
-        }
+        getProvisioningStatus(startupSnapshot.mailbox, locked, prov, support);
+        onProvisioning(support && prov);
+        return;
     }
+
+    ioExecutor->post(
+        []() {
+            bool locked = false;
+            bool prov = false;
+            bool support = false;
+            pfr::getProvisioningStatus(locked, prov, support);
+            return support && prov;
+        },
+        onProvisioning);
 }
-void checkPFRandAddObjects(sdbusplus::asio::object_server& server,
-                           std::shared_ptr<sdbusplus::asio::connection>& conn)
+
+// Exits if the strap reports no PFR. Returns true if it confirms PFR.
+static bool checkPresenceStrap()
 {
+    if (std::string_view(PFR_PRESENCE_GPIO).empty())
+    {
+        return false;
+    }
+
+    uint8_t value = 0;
+    if (readGPIOInput(PFR_PRESENCE_GPIO, value) < 0)
+    {
+        // Fall back to waiting for the PFR configuration.
+        return false;
+    }
+#ifdef PFR_PRESENCE_ACTIVE_LOW
+    bool present = (value == 0);
+#else
+    bool present = (value != 0);
+#endif
+    if (!present)
+    {
+        phosphor::logging::log<phosphor::logging::level::INFO>(
+            "Platform does not support PFR, hence stop the "
+            "service.");
+        std::exit(EXIT_SUCCESS);
+    }
+
+    // Strap confirms PFR. Bus and address are still updated once
+    // entity-manager publishes the configuration.
+    return true;
+}
+
+// Starts monitoring once PFR support is confirmed
+static void pfrSupported(sdbusplus::asio::object_server& server,
+                         std::shared_ptr<sdbusplus::asio::connection>& conn)
+{
+    if (pfrSupportConfirmed)
+    {
+        return;
+    }
+    pfrSupportConfirmed = true;
+
     checkPfrInterface(conn, server);
+    pfr::monitorSignals(server, conn);
 
-    constexpr size_t timeout = 10; // seconds
-    pfrObjTimer->expires_after(std::chrono::seconds(timeout));
-    pfrObjTimer->async_wait([&conn,
-                             &server](const boost::system::error_code& ec) {
-        if (ec)
-        {
-            if (ec == boost::asio::error::operation_aborted)
+    // The startup snapshot is current unless it was taken before the CPLD
+    // answered, or from another CPLD than the configured one.
+    if (!startupSnapshotCurrent())
+    {
+        updateDbusPropertiesCache();
+        updateCPLDversion(conn);
+    }
+}
+
+// Another node of a multi-node platform. Created once, a reload of the
+// configuration only updates the address.
+static void addPfrInstance(sdbusplus::asio::object_server& server,
+                           std::shared_ptr<sdbusplus::asio::connection>& conn,
+                           const std::string& path, const uint64_t i2cBus,
+                           const uint64_t address)
+{
+    IoExecutor& queue = busQueues->queue(i2cBusQueue(i2cBus));
+    auto& instance = pfrInstances[path];
+    if (instance)
+    {
+        instance->setAddress(i2cBus, address, queue);
+        return;
+    }
+    instance = std::make_unique<PfrInstance>(
+        server, conn, queue, PfrInstance::nameOf(path), i2cBus, address);
+}
+
+void checkPFRandAddObjects(boost::asio::io_context& io,
+                           sdbusplus::asio::object_server& server,
+                           std::shared_ptr<sdbusplus::asio::connection>& conn,
+                           const bool strapPresent)
+{
+    auto begin = PhaseLog::Clock::now();
+    configDiscovery = std::make_unique<ConfigDiscovery>(
+        io, conn,
+        [&server, &conn, begin](const std::string& path,
+                                const uint64_t i2cBus,
+                                const uint64_t address) {
+            if (!ConfigDiscovery::isBaseboardConfig(path))
             {
-                // Timer reset.
-                phosphor::logging::log<phosphor::logging::level::INFO>(
-                    "pfr object found. Hence Object Timer aborted or stopped.");
+                if (!baseboardConfigured)
+                {
+                    // Its bus may be the baseboard one, queue it there.
+                    pendingInstances[path] = {i2cBus, address};
+                    return;
+                }
+                addPfrInstance(server, conn, path, i2cBus, address);
+                return;
             }
-            else
+            uint64_t lastBus = 0;
+            uint64_t lastAddress = 0;
+            getMailboxAddress(lastBus, lastAddress);
+            bool moved = (lastBus != i2cBus) || (lastAddress != address);
+            setMailboxAddress(i2cBus, address);
+            // Other CPLDs on this bus share the baseboard queue.
+            busQueues->attach(i2cBusQueue(i2cBus), *ioExecutor);
+            if (!baseboardConfigured)
             {
-                phosphor::logging::log<phosphor::logging::level::ERR>(
-                    "pfr object timer error.");
+                baseboardConfigured = true;
+                recordStartupPhase("ConfigLoaded", begin);
+                for (const auto& [node, location] : pendingInstances)
+                {
+                    addPfrInstance(server, conn, node, location.first,
+                                   location.second);
+                }
+                pendingInstances.clear();
             }
-        }
-        if (retrCount > 0)
-        {
-            checkPFRandAddObjects(server, conn);
-        }
-        else
-        {
-            pfr::monitorSignals(server, conn);
+            if (pfrSupportConfirmed)
+            {
+                // Confirmed by the strap, or the configuration was
+                // published again. Reread on the configured bus.
+                updateDbusPropertiesCache();
+                if (moved)
+                {
+                    updateCPLDversion(conn);
+                }
+                return;
+            }
+            pfrSupported(server, conn);
+        },
+        []() {
+            if (pfrSupportConfirmed)
+            {
+                // Strap wins over a missing configuration.
+                return;
+            }
+            // Platform does not contain pfr object. Stop the service.
+            phosphor::logging::log<phosphor::logging::level::INFO>(
+                "Platform does not support PFR, hence stop the "
+                "service.");
+            std::exit(EXIT_SUCCESS);
+        });
+    configDiscovery->start();
 
-            // Update the D-Bus properties.
-            updateDbusPropertiesCache();
-            // Update CPLD Version to rot_fw_active object in settings.
-            updateCPLDversion(conn);
-        }
-        retrCount--;
+    if (strapPresent)
+    {
+        pfrSupported(server, conn);
+    }
+}
+
+// Reads every register and flash field needed by the startup objects
+// once. SPI flash and the SMBus mailbox are read concurrently.
+static void readStartupSnapshot()
+{
+    auto begin = PhaseLog::Clock::now();
+    auto spiRead = std::async(std::launch::async, []() {
+        std::string version = getFirmwareVersion(ImageType::bmcRecovery);
+        return std::make_pair(version, PhaseLog::Clock::now());
     });
+
+    getMailboxAddress(startupSnapshot.i2cBus, startupSnapshot.address);
+    if (readMailboxRegisters(statusAndVersionRegisters(),
+                             startupSnapshot.mailbox) == 0)
+    {
+        bool locked = false;
+        bool prov = false;
+        bool support = false;
+        startupSnapshot.valid =
+            (getProvisioningStatus(startupSnapshot.mailbox, locked, prov,
+                                   support) == 0) &&
+            support;
+    }
+    startupLog.record("SnapshotMailbox", begin);
+
+    for (const auto& imgType :
+         {ImageType::cpldActive, ImageType::cpldRecovery,
+          ImageType::biosRecovery, ImageType::afmActive,
+          ImageType::afmRecovery})
+    {
+        startupSnapshot.versions[imgType] =
+            getFirmwareVersion(imgType, startupSnapshot.mailbox);
+    }
+    auto [bmcVersion, spiDone] = spiRead.get();
+    startupSnapshot.versions[ImageType::bmcRecovery] = bmcVersion;
+    startupLog.record("SnapshotFlash", begin, spiDone);
 }
+
 } // namespace pfr
 
 int main()
 {
+    pfr::startupLog.record("ProcessStart", pfr::PhaseLog::Clock::now());
+
+    // Run against a simulated CPLD instead of the SMBus mailbox when a
+    // simulation script is given. Used for testing on non-PFR hosts.
+    const char* simScript = std::getenv("PFR_SIMULATED_CPLD");
+    if (simScript != nullptr)
+    {
+        auto simCpld = std::make_unique<pfr::SimulatedCpld>();
+        try
+        {
+            simCpld->loadScript(simScript);
+        }
+        catch (const std::exception& e)
+        {
+            phosphor::logging::log<phosphor::logging::level::ERR>(
+                "Failed to load CPLD simulation script.",
+                phosphor::logging::entry("MSG=%s", e.what()));
+            return EXIT_FAILURE;
+        }
+        pfr::setMailboxTransport(std::move(simCpld));
+        phosphor::logging::log<phosphor::logging::level::WARNING>(
+            "PFR: using simulated CPLD mailbox.");
+    }
+
     // setup connection to dbus
     boost::asio::io_context io;
     auto conn = std::make_shared<sdbusplus::asio::connection>(io);
+    // Hardware transactions run on their own thread so that a slow or
+    // wedged bus does not stall D-Bus traffic.
+    pfr::ioExecutor = std::make_unique<pfr::IoExecutor>(io);
+    pfr::busQueues = std::make_unique<pfr::BusQueues>(io);
+    pfr::IoExecutor& spiQueue = pfr::busQueues->queue(pfr::spiFlashQueue);
     pfr::stateTimer = std::make_unique<boost::asio::steady_timer>(io);
     pfr::initTimer = std::make_unique<boost::asio::steady_timer>(io);
-    pfr::pfrObjTimer = std::make_unique<boost::asio::steady_timer>(io);
+    pfr::lastEventsShadow =
+        std::make_unique<pfr::LastEventsShadow>(pfr::lastEventsStateFile);
+    pfr::lastEventsWriter = std::make_unique<pfr::LastEventsWriter>(io, conn);
     auto server = sdbusplus::asio::object_server(conn, true);
-    pfr::init(conn, pfr::i2cConfigLoaded);
+    bool strapPresent = pfr::checkPresenceStrap();
 
-    pfr::checkPFRandAddObjects(server, conn);
+    pfr::readStartupSnapshot();
+    auto objectsBegin = pfr::PhaseLog::Clock::now();
+    const auto& snapshot = pfr::startupSnapshot;
 
     // Update CPLD Version to rot_fw_active object in settings.
-    pfr::updateCPLDversion(conn);
+    pfr::setCPLDversion(conn,
+                        snapshot.versions.at(pfr::ImageType::cpldActive));
 
     server.add_manager("/xyz/openbmc_project/pfr");
 
+    pfr::pfrTimingObject = std::make_unique<pfr::PfrTiming>(server, conn);
+    pfr::pfrMetricsObject = std::make_unique<pfr::PfrMetrics>(server, conn);
+
     // Create PFR attributes object and interface
-    pfr::pfrConfigObject = std::make_unique<pfr::PfrConfig>(server, conn);
+    pfr::pfrConfigObject = std::make_unique<pfr::PfrConfig>(
+        server, conn, *pfr::ioExecutor, snapshot.mailbox);
 
     // Create Software objects using Versions interface
     for (const auto& entry : pfr::verComponentList)
     {
+        pfr::IoExecutor& queue = pfr::isSpiImage(std::get<1>(entry))
+                                     ? spiQueue
+                                     : *pfr::ioExecutor;
         pfr::pfrVersionObjects.emplace_back(std::make_unique<pfr::PfrVersion>(
-            server, conn, std::get<0>(entry), std::get<1>(entry),
-            std::get<2>(entry)));
+            server, conn, queue, std::get<0>(entry), std::get<1>(entry),
+            std::get<2>(entry), snapshot.versions.at(std::get<1>(entry))));
     }
 
     if (pfr::pfrConfigObject)
     {
-        pfr::pfrConfigObject->updateProvisioningStatus();
         if (pfr::pfrConfigObject->getPfrProvisioned())
         {
-            pfr::pfrPostcodeObject =
-                std::make_unique<pfr::PfrPostcode>(server, conn);
+            pfr::pfrPostcodeObject = std::make_unique<pfr::PfrPostcode>(
+                server, conn, *pfr::ioExecutor, snapshot.mailbox);
+
+            pfr::pfrPfmObjects.emplace_back(std::make_unique<pfr::PfrPfm>(
+                server, conn, spiQueue, "bmc_active",
+                pfr::ImageType::bmcActive));
+            pfr::pfrPfmObjects.emplace_back(std::make_unique<pfr::PfrPfm>(
+                server, conn, spiQueue, "bmc_recovery",
+                pfr::ImageType::bmcRecovery));
+            pfr::pfrRecoveryVerifyObject =
+                std::make_unique<pfr::PfrRecoveryVerify>(server, conn);
         }
     }
 
+    pfr::recordStartupPhase("ObjectsCreated", objectsBegin);
+
+    // Objects exist from here, monitoring may start right away.
+    pfr::checkPFRandAddObjects(io, server, conn, strapPresent);
+
+    auto nameBegin = pfr::PhaseLog::Clock::now();
     conn->request_name("xyz.openbmc_project.PFR.Manager");
+    pfr::recordStartupPhase("NameAcquired", nameBegin);
     phosphor::logging::log<phosphor::logging::level::INFO>(
         "Intel PFR service started successfully");
     io.run();
@@ -0,0 +1,254 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "pfr_instance.hpp"
+
+#include "event_catalog.hpp"
+#include "event_log.hpp"
+#include "pfr_mgr.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <array>
+#include <cctype>
+#include <filesystem>
+#include <utility>
+
+namespace pfr
+{
+
+static constexpr const char* instancePathBase = "/xyz/openbmc_project/pfr/";
+static constexpr const char* instanceStateDir = "/var/lib/pfr-manager/";
+
+// CPLD held versions, read from the mailbox of the instance.
+static constexpr std::array<std::pair<const char*, ImageType>, 6>
+    instanceVersions = {{{"rot_fw_active", ImageType::cpldActive},
+                         {"rot_fw_recovery", ImageType::cpldRecovery},
+                         {"bios_active", ImageType::biosActive},
+                         {"bios_recovery", ImageType::biosRecovery},
+                         {"afm_active", ImageType::afmActive},
+                         {"afm_recovery", ImageType::afmRecovery}}};
+
+PfrInstance::PfrInstance(sdbusplus::asio::object_server& srv_,
+                         std::shared_ptr<sdbusplus::asio::connection>& conn_,
+                         IoExecutor& executor_, const std::string& name_,
+                         const uint64_t i2cBus, const uint64_t address) :
+    server(srv_), conn(conn_), executor(&executor_), name(name_),
+    objPath(instancePathBase + name_),
+    transport(makeMailboxTransport(i2cBus, address)),
+    scheduler(std::chrono::milliseconds(PFR_POLL_MIN_MS),
+              std::chrono::milliseconds(PFR_POLL_MAX_MS),
+              std::chrono::milliseconds(PFR_POLL_IDLE_MS), PFR_POLL_BUDGET),
+    pollTimer(conn_->get_io_context()),
+    lastEvents(instanceStateDir + name_ + "/last_events")
+{
+    lg2::info("PFR instance {NAME} on bus {BUS} address {ADDR}", "NAME",
+              name, "BUS", i2cBus, "ADDR", address);
+
+    attrIface =
+        server.add_interface(objPath, "xyz.openbmc_project.PFR.Attributes");
+    attrBatch.emplace(conn, attrIface);
+    ufmProvisioned.emplace(*attrBatch, "UfmProvisioned", false);
+    ufmLocked.emplace(*attrBatch, "UfmLocked", false);
+    ufmSupport.emplace(*attrBatch, "UfmSupport", false);
+    attrIface->initialize();
+
+    postcodeIface = server.add_interface(
+        objPath, "xyz.openbmc_project.State.Boot.Platform");
+    postcodeBatch.emplace(conn, postcodeIface);
+    postcodeData.emplace(*postcodeBatch, "Data", uint8_t(0));
+    postcodeStr.emplace(*postcodeBatch, "PlatformState",
+                        std::string(postcodeName(0)));
+    postcodeIface->initialize();
+
+    // Same properties as the baseboard last events kept in Settings.
+    const LastEvents& last = lastEvents.get();
+    lastEventsIface =
+        server.add_interface(objPath, "xyz.openbmc_project.PFR.LastEvents");
+    lastEventsBatch.emplace(conn, lastEventsIface);
+    lastRecoveryCount.emplace(*lastEventsBatch, "lastRecoveryCount",
+                              last.recoveryCount);
+    lastPanicCount.emplace(*lastEventsBatch, "lastPanicCount",
+                           last.panicCount);
+    lastMajorErr.emplace(*lastEventsBatch, "lastMajorErr", last.majorErr);
+    lastMinorErr.emplace(*lastEventsBatch, "lastMinorErr", last.minorErr);
+    lastEventsIface->initialize();
+
+    for (const auto& [component, imgType] : instanceVersions)
+    {
+        auto object = std::make_unique<VersionObject>();
+        object->imgType = imgType;
+        object->iface =
+            server.add_interface(objPath + "/" + component,
+                                 "xyz.openbmc_project.Software.Version");
+        object->batch.emplace(conn, object->iface);
+        bool host = (imgType == ImageType::biosActive) ||
+                    (imgType == ImageType::biosRecovery);
+        object->iface->register_property(
+            "Purpose",
+            std::string(host ? versionPurposeHost : versionPurposeOther));
+        object->version.emplace(*object->batch, "Version", std::string());
+        object->iface->initialize();
+        versions.emplace_back(std::move(object));
+    }
+
+    poll();
+}
+
+PfrInstance::~PfrInstance()
+{
+    pollTimer.cancel();
+    for (const auto& object : versions)
+    {
+        server.remove_interface(object->iface);
+    }
+    server.remove_interface(lastEventsIface);
+    server.remove_interface(postcodeIface);
+    server.remove_interface(attrIface);
+}
+
+std::string PfrInstance::nameOf(const std::string& configPath)
+{
+    std::string board =
+        std::filesystem::path(configPath).parent_path().filename().string();
+    for (char& c : board)
+    {
+        if (!std::isalnum(static_cast<unsigned char>(c)))
+        {
+            c = '_';
+        }
+    }
+    return board;
+}
+
+void PfrInstance::setAddress(const uint64_t i2cBus, const uint64_t address,
+                             IoExecutor& queue)
+{
+    executor = &queue;
+    transport->setAddress(static_cast<int>(i2cBus), static_cast<int>(address));
+    // Reread everything on the next poll.
+    lastState.reset();
+}
+
+void PfrInstance::schedulePoll()
+{
+    pollTimer.expires_after(scheduler.next());
+    pollTimer.async_wait([this](const boost::system::error_code& ec) {
+        if (!ec)
+        {
+            poll();
+        }
+    });
+}
+
+void PfrInstance::poll()
+{
+    executor->post(
+        [transport = transport]() {
+            MailboxSnapshot snapshot{};
+            int ret = readMailboxSnapshot(*transport, snapshot);
+            return std::make_pair(ret, snapshot);
+        },
+        [this](const std::pair<int, MailboxSnapshot>& result) {
+            const auto& [ret, snapshot] = result;
+            if (ret == 0)
+            {
+                handleSnapshot(snapshot);
+            }
+            schedulePoll();
+        },
+        Priority::polling);
+}
+
+void PfrInstance::handleSnapshot(const MailboxSnapshot& snapshot)
+{
+    scheduler.observe(snapshot.platformState);
+
+    // Versions and provisioning only change across a state change, e.g.
+    // an update or a recovery.
+    if (lastState != snapshot.platformState)
+    {
+        lastState = snapshot.platformState;
+        postcodeData->set(snapshot.platformState);
+        postcodeStr->set(std::string(postcodeName(snapshot.platformState)));
+        postcodeBatch->flush();
+        refresh();
+    }
+
+    const LastEvents& last = lastEvents.get();
+    LastEvents current = logNewEvents(last, snapshot, name);
+    if (current == last)
+    {
+        return;
+    }
+    lastEvents.set(current);
+    lastRecoveryCount->set(current.recoveryCount);
+    lastPanicCount->set(current.panicCount);
+    lastMajorErr->set(current.majorErr);
+    lastMinorErr->set(current.minorErr);
+    lastEventsBatch->flush();
+}
+
+void PfrInstance::refresh(std::function<void()> done)
+{
+    executor->post(
+        [transport = transport]() {
+            MailboxRegisters regs;
+            int ret = readMailboxRegisters(
+                *transport, statusAndVersionRegisters(), regs);
+            return std::make_pair(ret, regs);
+        },
+        [this, done = std::move(done)](
+            const std::pair<int, MailboxRegisters>& result) {
+            const auto& [ret, regs] = result;
+            if (ret != 0)
+            {
+                // Keep the last values over a transient bus error.
+                if (done)
+                {
+                    done();
+                }
+                return;
+            }
+
+            bool locked = false;
+            bool provisioned = false;
+            bool support = false;
+            if (getProvisioningStatus(regs, locked, provisioned, support) ==
+                0)
+            {
+                ufmProvisioned->set(provisioned);
+                ufmLocked->set(locked);
+                ufmSupport->set(support);
+                attrBatch->flush();
+            }
+
+            for (const auto& object : versions)
+            {
+                if (object->version->set(
+                        getFirmwareVersion(object->imgType, regs)))
+                {
+                    object->batch->flush();
+                }
+            }
+            if (done)
+            {
+                done();
+            }
+        });
+}
+
+} // namespace pfr
@@ -17,6 +17,13 @@
 #include "pfr_mgr.hpp"
 
 #include "file.hpp"
+#include "format.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <tuple>
 
 namespace pfr
 {
@@ -35,14 +42,17 @@ using GetSubTreeType = std::vector<
     std::pair<std::string,
               std::vector<std::pair<std::string, std::vector<std::string>>>>>;
 
+// Write retries, spaced by a timer on the I/O thread.
+static constexpr unsigned int mailboxWriteRetries = 3;
+
 PfrVersion::PfrVersion(sdbusplus::asio::object_server& srv_,
                        std::shared_ptr<sdbusplus::asio::connection>& conn_,
-                       const std::string& path_, const ImageType& imgType_,
-                       const std::string& purpose_) :
-    server(srv_), conn(conn_), path(path_), imgType(imgType_), purpose(purpose_)
+                       IoExecutor& executor_, const std::string& path_,
+                       const ImageType& imgType_, const std::string& purpose_,
+                       const std::string& version_) :
+    server(srv_), executor(executor_), conn(conn_), path(path_),
+    imgType(imgType_), purpose(purpose_), version(version_)
 {
-    version = getFirmwareVersion(imgType);
-
     if (!(version == "0.0" || version.empty()))
     {
         printVersion(path, version);
@@ -54,22 +64,9 @@ PfrVersion::PfrVersion(sdbusplus::asio::object_server& srv_,
 
     if (versionIface != nullptr)
     {
+        versionBatch.emplace(conn, versionIface);
         versionIface->register_property("Purpose", purpose);
-        versionIface->register_property(
-            versionStr, version,
-            // Override set
-            [this](const std::string& req, std::string& propertyValue) {
-                if (internalSet)
-                {
-                    if (req != propertyValue)
-                    {
-                        version = req;
-                        propertyValue = req;
-                        return 1;
-                    }
-                }
-                return 0;
-            });
+        versionProp.emplace(*versionBatch, versionStr, version);
 
         versionIface->initialize();
     }
@@ -119,75 +116,48 @@ PfrVersion::PfrVersion(sdbusplus::asio::object_server& srv_,
     associationIface->set_property("Associations", associations);
 }
 
-void PfrVersion::updateVersion()
+void PfrVersion::updateVersion(std::function<void()> done)
 {
     if (versionIface && versionIface->is_initialized())
     {
-        std::string ver = getFirmwareVersion(imgType);
-        printVersion(path, ver);
-        internalSet = true;
-        versionIface->set_property(versionStr, ver);
-        internalSet = false;
+        executor.post(
+            [imgType = imgType]() { return getFirmwareVersion(imgType); },
+            [this, done = std::move(done)](const std::string& ver) {
+                if (versionProp->set(ver))
+                {
+                    printVersion(path, ver);
+                    versionBatch->flush();
+                }
+                if (done)
+                {
+                    done();
+                }
+            });
+        return;
+    }
+    if (done)
+    {
+        done();
     }
-    return;
 }
 
 PfrConfig::PfrConfig(sdbusplus::asio::object_server& srv_,
-                     std::shared_ptr<sdbusplus::asio::connection>& conn_) :
-    server(srv_), conn(conn_)
+                     std::shared_ptr<sdbusplus::asio::connection>& conn_,
+                     IoExecutor& executor_, const MailboxRegisters& regs) :
+    server(srv_), executor(executor_), conn(conn_)
 {
     pfrCfgIface = server.add_interface("/xyz/openbmc_project/pfr",
                                        "xyz.openbmc_project.PFR.Attributes");
 
-    ufmLocked = false;
-    ufmProvisioned = false;
-    ufmSupport = false;
-    getProvisioningStatus(ufmLocked, ufmProvisioned, ufmSupport);
-
-    pfrCfgIface->register_property(ufmProvisionedStr, ufmProvisioned,
-                                   // Override set
-                                   [this](const bool req, bool& propertyValue) {
-                                       if (internalSet)
-                                       {
-                                           if (req != propertyValue)
-                                           {
-                                               ufmProvisioned = req;
-                                               propertyValue = req;
-                                               return 1;
-                                           }
-                                       }
-                                       return 0;
-                                   });
-
-    pfrCfgIface->register_property(ufmLockedStr, ufmLocked,
-                                   // Override set
-                                   [this](const bool req, bool& propertyValue) {
-                                       if (internalSet)
-                                       {
-                                           if (req != propertyValue)
-                                           {
-                                               ufmLocked = req;
-                                               propertyValue = req;
-                                               return 1;
-                                           }
-                                       }
-                                       return 0;
-                                   });
-
-    pfrCfgIface->register_property(ufmSupportStr, ufmSupport,
-                                   // Override set
-                                   [this](const bool req, bool& propertyValue) {
-                                       if (internalSet)
-                                       {
-                                           if (req != propertyValue)
-                                           {
-                                               ufmSupport = req;
-                                               propertyValue = req;
-                                               return 1;
-                                           }
-                                       }
-                                       return 0;
-                                   });
+    bool locked = false;
+    bool provisioned = false;
+    bool support = false;
+    getProvisioningStatus(regs, locked, provisioned, support);
+
+    cfgBatch.emplace(conn, pfrCfgIface);
+    ufmProvisioned.emplace(*cfgBatch, ufmProvisionedStr, provisioned);
+    ufmLocked.emplace(*cfgBatch, ufmLockedStr, locked);
+    ufmSupport.emplace(*cfgBatch, ufmSupportStr, support);
 
     pfrCfgIface->initialize();
 
@@ -195,26 +165,86 @@ PfrConfig::PfrConfig(sdbusplus::asio::object_server& srv_,
     pfrMBIface = server.add_interface("/xyz/openbmc_project/pfr",
                                       "xyz.openbmc_project.PFR.Mailbox");
 
-    pfrMBIface->register_method("InitiateBMCBusyPeriod", [](bool setReset) {
-        if (setBMCBusy(setReset) < 0)
-        {
-            return false;
-        }
-        return true;
-    });
-
-    pfrMBIface->register_method("ReadMBRegister", [](uint32_t regAddr) {
-        uint8_t mailBoxReply = 0;
-        try
-        {
-            getMBRegister(regAddr, mailBoxReply);
-        }
-        catch (const std::exception& e)
-        {
-            throw;
-        }
-        return mailBoxReply;
-    });
+    pfrMBIface->register_method(
+        "InitiateBMCBusyPeriod",
+        [this](boost::asio::yield_context yield, bool setReset) {
+            int ret = executor.runWithRetry(
+                [setReset]() {
+                    try
+                    {
+                        return setBMCBusy(setReset);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        return -1;
+                    }
+                },
+                mailboxWriteRetries, yield, Priority::critical);
+            if (ret < 0)
+            {
+                return false;
+            }
+            return true;
+        });
+
+    pfrMBIface->register_method(
+        "ReadMBRegister",
+        [this](boost::asio::yield_context yield, uint32_t regAddr) {
+            auto [ret, mailBoxReply] = executor.run(
+                [regAddr]() {
+                    uint8_t reply = 0;
+                    try
+                    {
+                        return std::make_pair(getMBRegister(regAddr, reply),
+                                              reply);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        return std::make_pair(-1, reply);
+                    }
+                },
+                yield, Priority::polling);
+            if (ret != 0)
+            {
+                throw std::runtime_error("Failed to read PFR mailbox register");
+            }
+            return mailBoxReply;
+        });
+
+    // Register dumps for diagnostics, 32 registers per transaction.
+    pfrMBIface->register_method(
+        "ReadMBRegisters", [this](boost::asio::yield_context yield,
+                                  uint32_t offset, uint32_t count) {
+            auto [ret, data] = executor.run(
+                [offset, count]() {
+                    std::vector<uint8_t> regs;
+                    int ret = readMBRegisters(offset, count, regs);
+                    return std::make_pair(ret, regs);
+                },
+                yield, Priority::polling);
+            if (ret != 0)
+            {
+                throw std::runtime_error(
+                    "Failed to read PFR mailbox registers");
+            }
+            return data;
+        });
+
+    pfrMBIface->register_method(
+        "WriteMBRegisters",
+        [this](boost::asio::yield_context yield, uint32_t offset,
+               std::vector<uint8_t> data) {
+            int ret = executor.run(
+                [offset, data = std::move(data)]() {
+                    return writeMBRegisters(offset, data);
+                },
+                yield, Priority::polling);
+            if (ret != 0)
+            {
+                throw std::runtime_error(
+                    "Failed to write PFR mailbox registers");
+            }
+        });
     pfrMBIface->initialize();
 
     associationIface =
@@ -224,99 +254,751 @@ PfrConfig::PfrConfig(sdbusplus::asio::object_server& srv_,
     associationIface->initialize();
 }
 
-void PfrConfig::updateProvisioningStatus()
+void PfrConfig::updateProvisioningStatus(std::function<void()> done)
 {
     if (pfrCfgIface && pfrCfgIface->is_initialized())
     {
-        bool lockVal = false;
-        bool provVal = false;
-        bool supportVal = false;
-        getProvisioningStatus(lockVal, provVal, supportVal);
-        internalSet = true;
-        pfrCfgIface->set_property(ufmProvisionedStr, provVal);
-        pfrCfgIface->set_property(ufmLockedStr, lockVal);
-        pfrCfgIface->set_property(ufmSupportStr, supportVal);
-        internalSet = false;
+        executor.post(
+            []() {
+                std::array<bool, 3> status = {false, false, false};
+                getProvisioningStatus(status[0], status[1], status[2]);
+                return status;
+            },
+            [this, done = std::move(done)](const std::array<bool, 3>& status) {
+                const auto& [lockVal, provVal, supportVal] = status;
+                ufmProvisioned->set(provVal);
+                ufmLocked->set(lockVal);
+                ufmSupport->set(supportVal);
+                cfgBatch->flush();
+                if (done)
+                {
+                    done();
+                }
+            });
+        return;
+    }
+    if (done)
+    {
+        done();
     }
-    return;
 }
 
+static constexpr auto postcodeTtl =
+    std::chrono::milliseconds(PFR_POSTCODE_TTL_MS);
+static constexpr auto stateSampleInterval =
+    std::chrono::milliseconds(PFR_STATE_SAMPLE_MS);
 static constexpr const char* postcodeStrProp = "PlatformState";
-static constexpr const char* postcodeStrDefault = "Unknown";
 static constexpr const char* postcodeDataProp = "Data";
 static constexpr const char* postcodeIface =
     "xyz.openbmc_project.State.Boot.Platform";
+static constexpr const char* bootTimelineIface =
+    "xyz.openbmc_project.PFR.BootTimeline";
+static constexpr const char* bootTimelineProp = "Timeline";
+static constexpr const char* bootTimelineDir = "/run/pfr-manager";
+static constexpr const char* bootTimelineFile =
+    "/run/pfr-manager/boot_timeline.json";
+static constexpr uint8_t bootCompleteState = 0x0E;
 
 PfrPostcode::PfrPostcode(sdbusplus::asio::object_server& srv_,
-                         std::shared_ptr<sdbusplus::asio::connection>& conn_) :
-    server(srv_), conn(conn_)
+                         std::shared_ptr<sdbusplus::asio::connection>& conn_,
+                         IoExecutor& executor_, const MailboxRegisters& regs) :
+    server(srv_), executor(executor_),
+    sampler(conn_->get_io_context(), executor_, stateSampleInterval),
+    conn(conn_)
 {
-    if (getPlatformState(postcode) < 0)
+    uint8_t postcode = 0;
+    if (getPlatformState(regs, postcode) < 0)
     {
         postcode = 0;
     }
+    else
+    {
+        sampler.record(postcode);
+    }
 
     pfrPostcodeIface =
         server.add_interface("/xyz/openbmc_project/pfr", postcodeIface);
 
     if (pfrPostcodeIface != nullptr)
     {
-        pfrPostcodeIface->register_property(
-            postcodeDataProp, postcode,
-            // Override set
-            [this](const uint8_t req, uint8_t& propertyValue) {
-                if (internalSet)
-                {
-                    if (req != propertyValue)
-                    {
-                        postcode = req;
-                        propertyValue = req;
-                        return 1;
-                    }
-                }
-                return 0;
-            },
-            [this](uint8_t& propertyValue) {
-                updatePostcode();
-                propertyValue = postcode;
-                return propertyValue;
-            });
-
-        pfrPostcodeIface->register_property(postcodeStrProp,
-                                            std::string(postcodeStrDefault));
+        postcodeBatch.emplace(conn, pfrPostcodeIface);
+        // Serve the last value read, a fresh read is started on the I/O
+        // thread and signalled when it changes.
+        postcodeData.emplace(*postcodeBatch, postcodeDataProp, postcode,
+                             [this]() { updatePostcode(); });
+        postcodeStr.emplace(*postcodeBatch, postcodeStrProp,
+                            std::string(postcodeName(postcode)));
+
+        // <monotonic timestamp in microseconds, platform state> of the
+        // last transitions seen by the mailbox reads, oldest first.
+        pfrPostcodeIface->register_method("GetPlatformStateHistory", [this]() {
+            return sampler.history().read();
+        });
 
         pfrPostcodeIface->initialize();
-        auto it = postcodeMap.find(postcode);
-        if (it != postcodeMap.end())
+    }
+
+#ifdef PFR_BOOT_PROFILE
+    pfrBootTimelineIface =
+        server.add_interface("/xyz/openbmc_project/pfr", bootTimelineIface);
+    if (pfrBootTimelineIface != nullptr)
+    {
+        pfrBootTimelineIface->register_property(bootTimelineProp,
+                                                std::string());
+        pfrBootTimelineIface->initialize();
+    }
+
+    // Service started while the platform is still booting.
+    if (postcode != bootCompleteState)
+    {
+        startBootProfile();
+    }
+#endif
+}
+
+void PfrPostcode::startBootProfile()
+{
+    lg2::info("Profiling PFR boot timeline");
+    sampler.startProfile(
+        [this](const uint64_t startUs) { saveBootTimeline(startUs); });
+}
+
+// Escapes the JSON string specials, the postcode names are plain ASCII.
+static std::string jsonString(const std::string& str)
+{
+    std::string out = "\"";
+    for (const char c : str)
+    {
+        if ((c == '"') || (c == '\\'))
         {
-            pfrPostcodeIface->set_property(postcodeStrProp, it->second);
+            out += '\\';
         }
+        out += c;
     }
+    out += '"';
+    return out;
 }
 
-void PfrPostcode::updatePostcode()
+void PfrPostcode::saveBootTimeline(const uint64_t startUs)
 {
-    if (pfrPostcodeIface && pfrPostcodeIface->is_initialized())
+    // Transitions before the start only give the state the profile
+    // started in.
+    auto entries = sampler.history().read();
+    auto first = std::find_if(entries.begin(), entries.end(),
+                              [startUs](const auto& entry) {
+                                  return std::get<0>(entry) > startUs;
+                              });
+    if (first != entries.begin())
     {
-        if (getPlatformState(postcode) < 0)
+        first--;
+        std::get<0>(*first) = std::max(std::get<0>(*first), startUs);
+    }
+
+    std::string stages;
+    uint64_t endUs = startUs;
+    uint8_t lastState = 0;
+    for (auto it = first; it != entries.end(); it++)
+    {
+        const auto& [timestampUs, state] = *it;
+        endUs = timestampUs;
+        lastState = state;
+        if (std::next(it) == entries.end())
         {
-            postcode = 0;
+            break;
         }
 
-        internalSet = true;
-        pfrPostcodeIface->set_property(postcodeDataProp, postcode);
-        auto it = postcodeMap.find(postcode);
-        if (it == postcodeMap.end())
+        if (!stages.empty())
         {
-            pfrPostcodeIface->set_property(postcodeStrProp, postcodeStrDefault);
+            stages += ",";
+        }
+        stages += "{\"State\":" + std::to_string(state) + ",\"Name\":" +
+                  jsonString(std::string(postcodeName(state))) +
+                  ",\"OffsetMs\":" +
+                  std::to_string((timestampUs - startUs) / 1000) +
+                  ",\"DurationMs\":" +
+                  std::to_string((std::get<0>(*std::next(it)) - timestampUs) /
+                                 1000) +
+                  "}";
+    }
+
+    std::string timeline =
+        "{\"Complete\":" +
+        std::string((lastState == bootCompleteState) ? "true" : "false") +
+        ",\"TotalMs\":" + std::to_string((endUs - startUs) / 1000) +
+        ",\"Stages\":[" + stages + "]}";
+
+    std::error_code ec;
+    std::filesystem::create_directories(bootTimelineDir, ec);
+    std::string tmpFile = std::string(bootTimelineFile) + ".tmp";
+    {
+        std::ofstream file(tmpFile, std::ios::trunc);
+        file << timeline << "\n";
+    }
+    std::filesystem::rename(tmpFile, bootTimelineFile, ec);
+    if (ec)
+    {
+        lg2::error("Failed to write PFR boot timeline: {MSG}", "MSG",
+                   ec.message());
+    }
+
+    lg2::info("PFR boot timeline: {TOTAL} ms", "TOTAL",
+              (endUs - startUs) / 1000);
+    if (pfrBootTimelineIface != nullptr)
+    {
+        pfrBootTimelineIface->set_property(bootTimelineProp, timeline);
+    }
+}
+
+void PfrPostcode::recordPlatformState(const uint8_t state)
+{
+    sampler.record(state);
+    // As fresh as a Get read, the served value is at most a poll old.
+    lastReadValid = true;
+    lastRead = std::chrono::steady_clock::now();
+    setPostcode(state);
+}
+
+void PfrPostcode::updatePostcode()
+{
+    // Gets within the TTL, or while a read is in flight, share one read.
+    if (readPending || (lastReadValid && (std::chrono::steady_clock::now() -
+                                          lastRead) < postcodeTtl))
+    {
+        return;
+    }
+    readPending = true;
+    executor.post(
+        []() {
+            uint8_t state = 0;
+            int ret = getPlatformState(state);
+            return std::make_pair(ret, state);
+        },
+        [this](const std::pair<int, uint8_t>& result) {
+            const auto& [ret, state] = result;
+            readPending = false;
+            lastReadValid = true;
+            lastRead = std::chrono::steady_clock::now();
+            if (ret == 0)
+            {
+                sampler.record(state);
+                setPostcode(state);
+                return;
+            }
+            setPostcode(0);
+        },
+        Priority::polling);
+}
+
+void PfrPostcode::setPostcode(const uint8_t value)
+{
+    if (!postcodeBatch)
+    {
+        return;
+    }
+    postcodeData->set(value);
+    postcodeStr->set(std::string(postcodeName(value)));
+    // One signal for both, nothing if the state did not change.
+    postcodeBatch->flush();
+    return;
+}
+
+// Enough for the signatures, the PFM and the capsule bitmaps, the
+// compressed payload is never read.
+static constexpr size_t pfmImageMaxLength = 128 * 1024;
+static constexpr const char* pfmIfaceName = "xyz.openbmc_project.PFR.Pfm";
+static constexpr const char* capsuleIfaceName =
+    "xyz.openbmc_project.PFR.RecoveryCapsule";
+static constexpr uint8_t pfmReadAllowedMask = 0x01;
+static constexpr uint8_t pfmWriteAllowedMask = 0x02;
+
+// Decoded PFM. Definitions point into the image, kept until published.
+struct PfmTable
+{
+    std::shared_ptr<MtdImage> image;
+    SignatureBlock signature = {};
+    SignatureBlock capsuleSignature = {};
+    PfmHeader header = {};
+    std::vector<PfmDefinition> definitions;
+    std::optional<PbcHeader> pbc;
+    size_t activePages = 0;
+    size_t compressedPages = 0;
+    std::string error;
+};
+
+static std::string hexString(ByteSpan bytes)
+{
+    std::string str;
+    str.reserve(bytes.size() * 2);
+    for (const uint8_t byte : bytes)
+    {
+        str.append(hexDigits[byte].data(), hexDigits[byte].size());
+    }
+    return str;
+}
+
+static std::shared_ptr<PfmTable> decodePfm(const ImageType& imgType)
+{
+    auto table = std::make_shared<PfmTable>();
+    try
+    {
+        bool recovery = (imgType == ImageType::bmcRecovery);
+        table->image = std::make_shared<MtdImage>(
+            recovery ? bmcRecoveryImgMTDDev : bmcActiveImgPfmMTDDev,
+            pfmImageMaxLength);
+
+        std::optional<PfmParser> parser;
+        if (recovery)
+        {
+            RecoveryCapsule capsule(table->image->data());
+            table->capsuleSignature = capsule.signature();
+            table->pbc = capsule.pbc();
+            table->activePages = capsule.activePages();
+            table->compressedPages = capsule.compressedPages();
+            parser.emplace(capsule.pfm());
         }
         else
         {
-            pfrPostcodeIface->set_property(postcodeStrProp, it->second);
+            parser.emplace(table->image->data());
+        }
+
+        table->signature = parser->signature();
+        table->header = parser->header();
+        while (auto definition = parser->next())
+        {
+            table->definitions.emplace_back(*definition);
         }
-        internalSet = false;
     }
-    return;
+    catch (const std::exception& e)
+    {
+        // Definitions decoded before the error are still published.
+        table->error = e.what();
+    }
+    return table;
+}
+
+PfrPfm::PfrPfm(sdbusplus::asio::object_server& srv_,
+               std::shared_ptr<sdbusplus::asio::connection>& conn_,
+               IoExecutor& executor_, const std::string& name_,
+               const ImageType& imgType_) :
+    server(srv_), executor(executor_), conn(conn_),
+    objPath("/xyz/openbmc_project/pfr/pfm/" + name_), imgType(imgType_)
+{
+    pfmIface = server.add_interface(objPath, pfmIfaceName);
+    if (pfmIface != nullptr)
+    {
+        pfmIface->register_property("Svn", uint8_t(0));
+        pfmIface->register_property("BkcVersion", uint8_t(0));
+        pfmIface->register_property("MajorVersion", uint8_t(0));
+        pfmIface->register_property("MinorVersion", uint8_t(0));
+        pfmIface->register_property("Length", uint32_t(0));
+        pfmIface->register_property("ContentType", uint32_t(0));
+        pfmIface->register_property("OemData", std::string());
+        pfmIface->register_property("Error", std::string());
+        pfmIface->register_method("Refresh", [this]() { update(); });
+        pfmIface->initialize();
+    }
+
+    if (imgType == ImageType::bmcRecovery)
+    {
+        capsuleIface = server.add_interface(objPath, capsuleIfaceName);
+        if (capsuleIface != nullptr)
+        {
+            capsuleIface->register_property("ContentType", uint32_t(0));
+            capsuleIface->register_property("PageSize", uint32_t(0));
+            capsuleIface->register_property("BitmapBits", uint32_t(0));
+            capsuleIface->register_property("PayloadOffset", uint64_t(0));
+            capsuleIface->register_property("PayloadLength", uint32_t(0));
+            capsuleIface->register_property("ActivePages", uint64_t(0));
+            capsuleIface->register_property("CompressedPages", uint64_t(0));
+            capsuleIface->initialize();
+        }
+    }
+
+    update();
+}
+
+void PfrPfm::update()
+{
+    executor.post([imgType = imgType]() { return decodePfm(imgType); },
+                  [this](const std::shared_ptr<PfmTable>& table) {
+                      publish(*table);
+                  });
+}
+
+void PfrPfm::publish(const PfmTable& table)
+{
+    if (!table.error.empty())
+    {
+        lg2::error("Failed to decode PFM {PATH}: {MSG}", "PATH", objPath,
+                   "MSG", table.error);
+    }
+
+    if (pfmIface != nullptr)
+    {
+        pfmIface->set_property("Svn", table.header.svn);
+        pfmIface->set_property("BkcVersion", table.header.bkcVersion);
+        pfmIface->set_property("MajorVersion", table.header.majorVersion);
+        pfmIface->set_property("MinorVersion", table.header.minorVersion);
+        pfmIface->set_property("Length", table.header.length);
+        pfmIface->set_property("OemData", hexString(table.header.oemData));
+        pfmIface->set_property("ContentType", table.signature.pcType);
+        pfmIface->set_property("Error", table.error);
+    }
+
+    if ((capsuleIface != nullptr) && table.pbc)
+    {
+        capsuleIface->set_property("ContentType",
+                                   table.capsuleSignature.pcType);
+        capsuleIface->set_property("PageSize", table.pbc->pageSize);
+        capsuleIface->set_property("BitmapBits", table.pbc->bitmapBits);
+        capsuleIface->set_property(
+            "PayloadOffset", static_cast<uint64_t>(table.pbc->payloadOffset));
+        capsuleIface->set_property("PayloadLength", table.pbc->payloadLength);
+        capsuleIface->set_property(
+            "ActivePages", static_cast<uint64_t>(table.activePages));
+        capsuleIface->set_property(
+            "CompressedPages", static_cast<uint64_t>(table.compressedPages));
+    }
+
+    for (const auto& iface : entryIfaces)
+    {
+        server.remove_interface(iface);
+    }
+    entryIfaces.clear();
+
+    size_t regionIndex = 0;
+    size_t ruleIndex = 0;
+    size_t fvmIndex = 0;
+    for (const auto& definition : table.definitions)
+    {
+        std::shared_ptr<sdbusplus::asio::dbus_interface> iface;
+        if (const auto* region = std::get_if<PfmSpiRegion>(&definition))
+        {
+            iface = server.add_interface(
+                objPath + "/spi_region" + std::to_string(regionIndex++),
+                "xyz.openbmc_project.PFR.SpiRegion");
+            if (iface == nullptr)
+            {
+                continue;
+            }
+            iface->register_property("StartAddress", region->startAddress);
+            iface->register_property("EndAddress", region->endAddress);
+            iface->register_property("ProtectionMask",
+                                     region->protectionMask);
+            iface->register_property(
+                "ReadAllowed",
+                static_cast<bool>(region->protectionMask & pfmReadAllowedMask));
+            iface->register_property(
+                "WriteAllowed", static_cast<bool>(region->protectionMask &
+                                                  pfmWriteAllowedMask));
+            iface->register_property("Sha256", hexString(region->sha256));
+            iface->register_property("Sha384", hexString(region->sha384));
+        }
+        else if (const auto* rule = std::get_if<PfmSmbusRule>(&definition))
+        {
+            // Whitelist bitmap as the list of allowed command codes.
+            std::vector<uint8_t> commands;
+            for (size_t cmd = 0; cmd < (rule->commandWhitelist.size() * 8);
+                 cmd++)
+            {
+                if (rule->commandWhitelist[cmd / 8] & (1 << (cmd % 8)))
+                {
+                    commands.push_back(cmd);
+                }
+            }
+            iface = server.add_interface(
+                objPath + "/smbus_rule" + std::to_string(ruleIndex++),
+                "xyz.openbmc_project.PFR.SmbusRule");
+            if (iface == nullptr)
+            {
+                continue;
+            }
+            iface->register_property("BusId", rule->busId);
+            iface->register_property("RuleId", rule->ruleId);
+            iface->register_property("Address", rule->address);
+            iface->register_property("AllowedCommands", commands);
+        }
+        else if (const auto* fvm = std::get_if<PfmFvmAddress>(&definition))
+        {
+            iface = server.add_interface(
+                objPath + "/fvm" + std::to_string(fvmIndex++),
+                "xyz.openbmc_project.PFR.FvmAddress");
+            if (iface == nullptr)
+            {
+                continue;
+            }
+            iface->register_property("FvType", fvm->fvType);
+            iface->register_property("Address", fvm->address);
+        }
+        iface->initialize();
+        entryIfaces.emplace_back(std::move(iface));
+    }
+}
+
+static constexpr const char* recoveryVerifyIface =
+    "xyz.openbmc_project.PFR.RecoveryVerify";
+static constexpr const char* verifyProgressProp = "Progress";
+
+struct VerifyOutcome
+{
+    std::vector<RegionVerifyResult> regions;
+    std::string error;
+};
+
+PfrRecoveryVerify::PfrRecoveryVerify(
+    sdbusplus::asio::object_server& srv_,
+    std::shared_ptr<sdbusplus::asio::connection>& conn_) :
+    server(srv_), conn(conn_)
+{
+    verifyIface =
+        server.add_interface("/xyz/openbmc_project/pfr", recoveryVerifyIface);
+    if (verifyIface == nullptr)
+    {
+        return;
+    }
+
+    verifyIface->register_property(verifyProgressProp, progress);
+
+    // Returns <start address, end address, passed> of every hashed SPI
+    // region in the recovery image PFM.
+    verifyIface->register_method(
+        "VerifyRecoveryImage", [this](boost::asio::yield_context yield) {
+            if (verifying)
+            {
+                throw std::runtime_error(
+                    "Recovery image verification in progress");
+            }
+            verifying = true;
+            progress = 0;
+            postedProgress = 0;
+            verifyIface->set_property(verifyProgressProp, progress);
+            if (worker.joinable())
+            {
+                worker.join();
+            }
+
+            // Hashing takes seconds, keep it off the D-Bus and the mailbox
+            // I/O threads.
+            auto outcome = boost::asio::async_initiate<
+                boost::asio::yield_context,
+                void(std::shared_ptr<VerifyOutcome>)>(
+                [this](auto handler) {
+                    worker = std::thread([this, handler = std::move(
+                                                    handler)]() mutable {
+                        auto outcome = std::make_shared<VerifyOutcome>();
+                        try
+                        {
+                            outcome->regions = verifyRecoveryImage(
+                                bmcRecoveryImgMTDDev, 0,
+                                [this](const uint64_t done,
+                                       const uint64_t total) {
+                                    reportProgress(done, total);
+                                });
+                        }
+                        catch (const std::exception& e)
+                        {
+                            outcome->error = e.what();
+                        }
+                        boost::asio::post(
+                            conn->get_io_context(),
+                            [handler = std::move(handler),
+                             outcome]() mutable { handler(outcome); });
+                    });
+                },
+                yield);
+            verifying = false;
+
+            if (!outcome->error.empty())
+            {
+                lg2::error("Recovery image verification failed: {MSG}",
+                           "MSG", outcome->error);
+                throw std::runtime_error(outcome->error);
+            }
+
+            std::vector<std::tuple<uint32_t, uint32_t, bool>> reply;
+            size_t failed = 0;
+            for (const auto& region : outcome->regions)
+            {
+                reply.emplace_back(region.startAddress, region.endAddress,
+                                   region.passed);
+                failed += region.passed ? 0 : 1;
+            }
+            lg2::info("Recovery image verified: {FAILED} of {TOTAL} "
+                      "regions failed",
+                      "FAILED", failed, "TOTAL", reply.size());
+            progress = 100;
+            verifyIface->set_property(verifyProgressProp, progress);
+            return reply;
+        });
+
+    verifyIface->initialize();
+}
+
+PfrRecoveryVerify::~PfrRecoveryVerify()
+{
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+void PfrRecoveryVerify::reportProgress(const uint64_t done,
+                                       const uint64_t total)
+{
+    uint8_t percent = total ? static_cast<uint8_t>((done * 100) / total) : 0;
+    uint8_t last = postedProgress.load();
+    // Post each new percentage once, not every chunk.
+    if ((percent <= last) ||
+        !postedProgress.compare_exchange_strong(last, percent))
+    {
+        return;
+    }
+    boost::asio::post(conn->get_io_context(), [this, percent]() {
+        if (verifying && (percent > progress))
+        {
+            progress = percent;
+            verifyIface->set_property(verifyProgressProp, progress);
+        }
+    });
+}
+
+static constexpr const char* metricsIfaceName =
+    "xyz.openbmc_project.PFR.Metrics";
+
+// <count, retries, failures, latency histogram>
+using MetricsEntry =
+    std::tuple<uint64_t, uint64_t, uint64_t, std::vector<uint64_t>>;
+
+static MetricsEntry toMetricsEntry(const TransactionStats& stats)
+{
+    return MetricsEntry(
+        stats.count, stats.retries, stats.failures,
+        std::vector<uint64_t>(stats.latency.begin(), stats.latency.end()));
+}
+
+// <count, deadline misses, retries, max queueing delay usec, bus time usec>
+using SchedulerEntry =
+    std::tuple<uint64_t, uint64_t, uint64_t, uint64_t, uint64_t>;
+
+// Names of the Priority classes, in order.
+static constexpr std::array<const char*, priorityClasses> priorityNames = {
+    "Critical", "Polling", "Background"};
+
+PfrMetrics::PfrMetrics(sdbusplus::asio::object_server& srv_,
+                       std::shared_ptr<sdbusplus::asio::connection>& conn_) :
+    server(srv_), conn(conn_)
+{
+    metricsIface =
+        server.add_interface("/xyz/openbmc_project/pfr", metricsIfaceName);
+    if (metricsIface == nullptr)
+    {
+        return;
+    }
+
+    // Counters change on every transaction, no PropertiesChanged.
+    // Registers of every CPLD mailbox, by I2C device, e.g. 4-0038. A block
+    // transfer counts once, on its start register only.
+    metricsIface->register_property_r(
+        "Registers", std::map<std::string, std::map<uint8_t, MetricsEntry>>{},
+        sdbusplus::vtable::property_::none,
+        [](const std::map<std::string, std::map<uint8_t, MetricsEntry>>&) {
+            std::map<std::string, std::map<uint8_t, MetricsEntry>> entries;
+            for (const auto& [device, registers] : mailboxStats())
+            {
+                auto& deviceEntries = entries[device];
+                for (const auto& [offset, stats] : registers)
+                {
+                    deviceEntries.emplace(offset, toMetricsEntry(stats));
+                }
+            }
+            return entries;
+        });
+    metricsIface->register_property_r(
+        "MtdDevices", std::map<std::string, MetricsEntry>{},
+        sdbusplus::vtable::property_::none,
+        [](const std::map<std::string, MetricsEntry>&) {
+            std::map<std::string, MetricsEntry> entries;
+            for (const auto& [mtdDev, stats] : mtdStats())
+            {
+                entries.emplace(mtdDev, toMetricsEntry(stats));
+            }
+            return entries;
+        });
+
+    metricsIface->register_property_r(
+        "Scheduler", std::map<std::string, SchedulerEntry>{},
+        sdbusplus::vtable::property_::none,
+        [](const std::map<std::string, SchedulerEntry>&) {
+            std::map<std::string, SchedulerEntry> entries;
+            auto stats = schedulerStats();
+            for (size_t i = 0; i < priorityClasses; i++)
+            {
+                entries.emplace(priorityNames[i],
+                                SchedulerEntry(stats[i].count,
+                                               stats[i].deadlineMisses,
+                                               stats[i].retries,
+                                               stats[i].maxWaitUsec,
+                                               stats[i].busyUsec));
+            }
+            return entries;
+        });
+
+    // Lower bound of every histogram bucket, in usec.
+    std::vector<uint64_t> bounds(latencyBuckets, 0);
+    for (size_t i = 1; i < latencyBuckets; i++)
+    {
+        bounds[i] = uint64_t(1) << i;
+    }
+    metricsIface->register_property("LatencyBucketsUsec", bounds);
+
+    metricsIface->register_method("Reset", []() { resetMetrics(); });
+    metricsIface->initialize();
+}
+
+static constexpr const char* timingIfaceName = "xyz.openbmc_project.PFR.Timing";
+
+PfrTiming::PfrTiming(sdbusplus::asio::object_server& srv_,
+                     std::shared_ptr<sdbusplus::asio::connection>& conn_) :
+    server(srv_), conn(conn_)
+{
+    timingIface =
+        server.add_interface("/xyz/openbmc_project/pfr", timingIfaceName);
+    if (timingIface == nullptr)
+    {
+        return;
+    }
+
+    // Phases are <name, CLOCK_MONOTONIC end in usec, duration in usec>.
+    timingBatch.emplace(conn, timingIface);
+    startupPhases.emplace(*timingBatch, "StartupPhases",
+                          std::vector<PhaseLog::Phase>{});
+    refreshPhases.emplace(*timingBatch, "RefreshPhases",
+                          std::vector<PhaseLog::Phase>{});
+    refreshCount.emplace(*timingBatch, "RefreshCount", 0);
+    refreshMaxUsec.emplace(*timingBatch, "RefreshMaxUsec", 0);
+    timingIface->initialize();
+}
+
+void PfrTiming::setStartupPhases(const PhaseLog& log)
+{
+    if (!timingBatch)
+    {
+        return;
+    }
+    startupPhases->set(log.phases());
+    timingBatch->flush();
+}
+
+void PfrTiming::setRefreshPhases(const PhaseLog& log)
+{
+    if (!timingBatch)
+    {
+        return;
+    }
+    refreshPhases->set(log.phases());
+    refreshCount->set(refreshCount->get() + 1);
+    refreshMaxUsec->set(std::max(refreshMaxUsec->get(), log.elapsed()));
+    timingBatch->flush();
 }
 
 } // namespace pfr
@@ -0,0 +1,157 @@
+/*
+// Copyright (c) 2019 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+*/
+
+#include "state_history.hpp"
+
+#include "pfr.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+
+namespace pfr
+{
+
+// Boot profiling resolution. The next read is queued once the previous
+// one completed, never more often than the bus serves them.
+static constexpr std::chrono::milliseconds profileInterval(10);
+// Failed reads are retried slower and slower, up to every 10 seconds.
+static constexpr std::chrono::milliseconds maxBackoff(10000);
+// Give up if the platform has not left T0 boot complete by then.
+static constexpr std::chrono::seconds profileArmTimeout(60);
+// Give up on a boot that never completes, e.g. stuck in recovery.
+static constexpr std::chrono::minutes profileTimeout(30);
+static constexpr uint8_t bootCompleteState = 0x0E;
+
+static uint64_t toMicroseconds(const std::chrono::steady_clock::time_point& t)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               t.time_since_epoch())
+        .count();
+}
+
+PlatformStateSampler::PlatformStateSampler(
+    boost::asio::io_context& io, IoExecutor& executor_,
+    const std::chrono::milliseconds& interval_) :
+    executor(executor_), timer(io), interval(interval_)
+{
+    sample(std::chrono::milliseconds(0));
+}
+
+void PlatformStateSampler::record(const uint8_t state)
+{
+    if (!stateValid || (state != lastState))
+    {
+        transitions.push(toMicroseconds(std::chrono::steady_clock::now()),
+                         state);
+        lastState = state;
+        stateValid = true;
+    }
+
+    if (profiling)
+    {
+        checkProfile(state);
+    }
+}
+
+void PlatformStateSampler::startProfile(ProfileHandler handler)
+{
+    profiling = true;
+    profileBootSeen = false;
+    profileStart = std::chrono::steady_clock::now();
+    profileHandler = std::move(handler);
+    if (backoff.count() == 0)
+    {
+        // Sample at the profile rate from now on.
+        sample(std::chrono::milliseconds(0));
+    }
+}
+
+void PlatformStateSampler::sample(const std::chrono::milliseconds& delay)
+{
+    timer.expires_after(delay);
+    timer.async_wait([this](const boost::system::error_code& ec) {
+        if (ec || readPending)
+        {
+            return;
+        }
+        readPending = true;
+        // A polling transaction, within the class budget and behind any
+        // critical write.
+        executor.post(
+            []() {
+                uint8_t state = 0;
+                int ret = getPlatformState(state);
+                return std::make_pair(ret, state);
+            },
+            [this](const std::pair<int, uint8_t>& result) {
+                readPending = false;
+                const auto& [ret, state] = result;
+                if (ret != 0)
+                {
+                    if (!failureLogged)
+                    {
+                        failureLogged = true;
+                        lg2::warning("Cannot sample the platform state, "
+                                     "backing off");
+                    }
+                    backoff = std::min(std::max(backoff * 2, interval),
+                                       maxBackoff);
+                    sample(backoff);
+                    return;
+                }
+                if (failureLogged)
+                {
+                    failureLogged = false;
+                    lg2::info("Platform state sampling recovered");
+                }
+                backoff = std::chrono::milliseconds(0);
+                record(state);
+                sample(profiling ? profileInterval : interval);
+            },
+            Priority::polling);
+    });
+}
+
+void PlatformStateSampler::checkProfile(const uint8_t state)
+{
+    if (state != bootCompleteState)
+    {
+        profileBootSeen = true;
+        if ((std::chrono::steady_clock::now() - profileStart) < profileTimeout)
+        {
+            return;
+        }
+    }
+    else if (!profileBootSeen)
+    {
+        if ((std::chrono::steady_clock::now() - profileStart) >=
+            profileArmTimeout)
+        {
+            profiling = false;
+            profileHandler = nullptr;
+        }
+        return;
+    }
+
+    // Boot completed, or timed out with the partial timeline.
+    profiling = false;
+    ProfileHandler handler = std::move(profileHandler);
+    profileHandler = nullptr;
+    handler(toMicroseconds(profileStart));
+}
+
+} // namespace pfr